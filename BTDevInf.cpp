@@ -1,30 +1,98 @@
 #include "BTDevInf.h"
+#include "BTDevInfValuePool.h"
+
+#ifdef BTDEVINF_WARN_LONG_VALUES
+#include <NimBLELog.h>
+#endif
+
+namespace {
+  const uint8_t SNAPSHOT_MAGIC[4] = {'B', 'D', 'I', 'S'};
+  const size_t SNAPSHOT_HEADER_LENGTH = 8;
+  const size_t SNAPSHOT_ENTRY_LENGTH = 8;
+  const size_t SNAPSHOT_CHECKSUM_LENGTH = 4;
+  const uint8_t SNAPSHOT_DESCRIPTOR_POLICY_MASK = 0x03;
+  const uint8_t SNAPSHOT_CONCURRENT_UPDATES = 0x04;
+  
+  const uint16_t PRIMARY_SERVICE_UUID = 0x2800;
+  const uint16_t CHARACTERISTIC_DECLARATION_UUID = 0x2803;
+  
+  // Time a long read may take per request, in connection intervals
+  const uint32_t LONG_READ_INTERVALS_PER_REQUEST = 4;
+  
+  uint16_t readU16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+  }
+  
+  uint32_t readU32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+  }
+  
+  void writeU16(uint8_t* data, uint16_t value) {
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+  }
+  
+  void writeU32(uint8_t* data, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      data[i] = (value >> (8 * i)) & 0xFF;
+    }
+  }
+  
+  // A value no attribute can hold; the setters reject it and Builder::commit() skips it and reports failure, silently unless BTDEVINF_WARN_LONG_VALUES is defined
+  void warnIfTooLong(BTDevInfCharacteristic characteristic, size_t length) {
+#ifdef BTDEVINF_WARN_LONG_VALUES
+    if (length > BLE_ATT_ATTR_MAX_LEN) {
+      NIMBLE_LOGW("BTDevInf", "%s value of %u octets is longer than %u", BTDEVINF_CHARACTERISTIC_SPECS[static_cast<size_t>(characteristic)].user_description,
+        static_cast<unsigned>(length), static_cast<unsigned>(BLE_ATT_ATTR_MAX_LEN));
+    }
+#else
+    (void)characteristic;
+    (void)length;
+#endif
+  }
+}
 
 /**
  * @brief Construct a BTDevInf instance
  * @param server A pointer to the server instance this Device Information Service will use
  * @note This service exposes manufacturer and/or vendor information about a device.
  */
-BTDevInf::BTDevInf(NimBLEServer* server) {
-  if (server == nullptr) return;
-  
+BTDevInf::BTDevInf(NimBLEServer* server) : characteristic_callbacks(this) {
   device_info_service = nullptr;
+  service_created = false;
+  read_counters = nullptr;
+  advertising = nullptr;
+  stable_read_mtu = 0;
+  layout = 0;
   
-  system_id_characteristic = nullptr;
-  model_number_string_characteristic = nullptr;
-  serial_number_string_characteristic = nullptr;
-  firmware_revision_string_characteristic = nullptr;
-  hardware_revision_string_characteristic = nullptr;
-  software_revision_string_characteristic = nullptr;
-  manufacturer_name_string_characteristic = nullptr;
-  ieee_regulatory_certification_data_list_characteristic = nullptr;
-  pnp_id_characteristic = nullptr;
-  udi_for_medical_devices_characteristic = nullptr;
+  for (CharacteristicSlot& slot : slots) {
+    slot.characteristic = nullptr;
+    slot.max_length = 0;
+    slot.descriptor_policy = BTDevInfDescriptorPolicy::FULL;
+    slot.descriptor_count = 0;
+    slot.published = nullptr;
+    slot.pooled = nullptr;
+    clearValueSource(slot);
+  }
+  
+  if (server == nullptr) return;
   
   // Get existing service or create new one
-  device_info_service = server->getServiceByUUID(DEVICE_INFORMATION_SERVICE_UUID);
+  device_info_service = server->getServiceByUUID(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
   if (device_info_service == nullptr) {
-    device_info_service = server->createService(DEVICE_INFORMATION_SERVICE_UUID);
+    device_info_service = server->createService(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
+    service_created = true;
+  }
+}
+
+BTDevInf::~BTDevInf() {
+  delete[] read_counters;
+  for (CharacteristicSlot& slot : slots) {
+    clearValueSource(slot);
+    if (slot.published == nullptr) continue;
+    delete[] slot.published->words;
+    delete[] slot.published->read_buffer;
+    delete slot.published;
   }
 }
 
@@ -39,151 +107,1039 @@ bool BTDevInf::startService() {
   return false;
 }
 
-void BTDevInf::setupDescriptors(NimBLECharacteristic* characteristic, const char* user_description, uint8_t format, int8_t exponent, uint16_t unit, uint8_t namespace_value, uint16_t description) {
-  if (characteristic == nullptr) return;
+/**
+ * @brief Add the descriptors a descriptor policy asks for to a new characteristic
+ * @param characteristic The characteristic, as just created from spec
+ * @param spec Its row of BTDEVINF_CHARACTERISTIC_SPECS, which gives the user description and format
+ * @param policy Which descriptors to add
+ * @return Number of descriptors added
+ * @note Shared by BTDevInf and BTDevInfStatic, so both build the same attributes.
+ */
+uint8_t btdevinfCreateDescriptors(NimBLECharacteristic* characteristic, const BTDevInfCharacteristicSpec& spec, BTDevInfDescriptorPolicy policy) {
+  if (characteristic == nullptr || policy == BTDevInfDescriptorPolicy::NONE) return 0;
+  
+  uint8_t descriptor_count = 0;
   
   // User Description Descriptor
-  NimBLEDescriptor* characteristic_user_description_descriptor = characteristic->createDescriptor(NimBLEUUID("2901"), NIMBLE_PROPERTY::READ);
-  characteristic_user_description_descriptor->setValue(user_description);
+  if (policy == BTDevInfDescriptorPolicy::FULL) {
+    NimBLEDescriptor* characteristic_user_description_descriptor = characteristic->createDescriptor(NimBLEUUID(CHARACTERISTIC_USER_DESCRIPTION_DESCRIPTOR_UUID), NIMBLE_PROPERTY::READ, strlen(spec.user_description));
+    characteristic_user_description_descriptor->setValue(spec.user_description);
+    descriptor_count++;
+  }
   
   // Presentation Format Descriptor
-  NimBLE2904* characteristic_presentation_format_descriptor = (NimBLE2904*)characteristic->createDescriptor(NimBLEUUID("2904"));
+  NimBLE2904* characteristic_presentation_format_descriptor = (NimBLE2904*)characteristic->createDescriptor(NimBLEUUID(CHARACTERISTIC_PRESENTATION_FORMAT_DESCRIPTOR_UUID));
+  
+  characteristic_presentation_format_descriptor->setFormat(spec.format);
+  characteristic_presentation_format_descriptor->setExponent(0x00);
+  characteristic_presentation_format_descriptor->setUnit(0x0000);
+  characteristic_presentation_format_descriptor->setNamespace(0x01);
+  characteristic_presentation_format_descriptor->setDescription(0x0000);
+  descriptor_count++;
+  
+  return descriptor_count;
+}
+
+NimBLECharacteristic* BTDevInf::createCharacteristic(BTDevInfCharacteristic characteristic, uint16_t max_length) {
+  CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (device_info_service == nullptr || slot.characteristic != nullptr) return slot.characteristic;
+  // A canonical layout is complete from the start; nothing is added after it
+  if (layout != 0) return nullptr;
+  
+  const BTDevInfCharacteristicSpec& spec = BTDEVINF_CHARACTERISTIC_SPECS[static_cast<size_t>(characteristic)];
+  
+  // A service this instance created can only hold characteristics it created itself
+  if (!service_created) {
+    slot.characteristic = device_info_service->getCharacteristic(NimBLEUUID(spec.uuid));
+  }
+  if (slot.characteristic == nullptr) {
+    slot.characteristic = device_info_service->createCharacteristic(NimBLEUUID(spec.uuid), spec.properties, max_length);
+    slot.max_length = max_length;
+    slot.descriptor_count = btdevinfCreateDescriptors(slot.characteristic, spec, slot.descriptor_policy);
+    if (read_counters != nullptr) slot.characteristic->setCallbacks(&characteristic_callbacks);
+  } else {
+    slot.max_length = BLE_ATT_ATTR_MAX_LEN;
+    if (read_counters != nullptr) slot.characteristic->setCallbacks(&characteristic_callbacks);
+  }
+  
+  return slot.characteristic;
+}
+
+BTDevInf::CharacteristicSlot* BTDevInf::findSlot(const NimBLECharacteristic* characteristic) {
+  for (CharacteristicSlot& slot : slots) {
+    if (slot.characteristic == characteristic) return &slot;
+  }
+  return nullptr;
+}
+
+void BTDevInf::recordRead(const CharacteristicSlot& slot, const NimBLEConnInfo& conn_info) {
+  size_t index = &slot - slots;
+  ReadCounters& counters = read_counters[index];
+  
+  counters.read_count.fetch_add(1, std::memory_order_relaxed);
+  counters.last_read_ms.store(ble_npl_time_ticks_to_ms32(ble_npl_time_get()), std::memory_order_relaxed);
+  uint32_t connection_bit = 1u << (conn_info.getConnHandle() % 32);
+  if (!(counters.reading_connections.fetch_or(connection_bit, std::memory_order_relaxed) & connection_bit)) {
+    counters.connection_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void BTDevInf::clearValueSource(CharacteristicSlot& slot) {
+  if (slot.pooled != nullptr) BTDevInfValuePool::release(slot.pooled);
+  slot.pooled = nullptr;
+  slot.static_data = nullptr;
+  slot.static_length = 0;
+  slot.provider = nullptr;
+  slot.provider_context = nullptr;
+  slot.provided = false;
+}
+
+void BTDevInf::CharacteristicCallbacks::onRead(NimBLECharacteristic* characteristic, NimBLEConnInfo& conn_info) {
+  CharacteristicSlot* slot = device_info->findSlot(characteristic);
+  if (slot == nullptr) return;
+  
+  if (device_info->read_counters != nullptr) {
+    device_info->recordRead(*slot, conn_info);
+  }
+  
+  // NimBLE only calls this for the first request of a read, so the Read Blob requests that follow see the same value
+  if (slot->published != nullptr) {
+    PublishedValue& published = *slot->published;
+    uint32_t connection_bit = 1u << (conn_info.getConnHandle() % 32);
+    uint32_t now_ms = ble_npl_time_ticks_to_ms32(ble_npl_time_get());
+    
+    // A new read on a connection ends its last one. Another connection part-way through a long read still needs the value as it is, so this read shares it
+    published.readers &= ~connection_bit;
+    if (published.readers == 0 || static_cast<int32_t>(published.read_until_ms - now_ms) <= 0) {
+      size_t length = readPublished(published, published.read_buffer, slot->max_length);
+      characteristic->setValue(published.read_buffer, length);
+      published.readers = 0;
+      published.read_until_ms = now_ms;
+    }
+    
+    uint16_t round_trips = countReadRoundTrips(characteristic->getAttVal().size(), conn_info.getMTU());
+    if (round_trips > 1) {
+      uint32_t until_ms = now_ms + round_trips * LONG_READ_INTERVALS_PER_REQUEST * conn_info.getConnInterval() * 5 / 4;
+      published.readers |= connection_bit;
+      if (static_cast<int32_t>(until_ms - published.read_until_ms) > 0) published.read_until_ms = until_ms;
+    }
+  } else if (slot->provider != nullptr) {
+    if (!slot->provided.exchange(true)) {
+      uint8_t* buffer = new uint8_t[slot->max_length];
+      size_t length = slot->provider(buffer, slot->max_length, slot->provider_context);
+      characteristic->setValue(buffer, length > slot->max_length ? slot->max_length : length);
+      delete[] buffer;
+    }
+  } else if (slot->static_data != nullptr) {
+    characteristic->setValue(slot->static_data, slot->static_length);
+  }
+}
+
+/**
+ * @brief Set the value of any Device Information characteristic, creating it on first use
+ * @param characteristic The characteristic to set
+ * @param data The value
+ * @param length Length of the data in octets
+ * @return true if successful, false if service doesn't exist, the characteristic is outside the canonical layout or the value is longer than the characteristic allows
+ * @note The named setters below are thin wrappers around this function. The string setters take std::string_view, so literals, char buffers and std::string values all reach the characteristic without a temporary std::string; the value is copied once, into the characteristic, which only allocates when the value outgrows its buffer.
+ * @note The value is copied into the characteristic. Any static value or value provider registered before is released.
+ * @note Only safe to call from the task that set up the service, unless enableConcurrentUpdates() was called for the characteristic.
+ */
+bool BTDevInf::setValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length) {
+  if (device_info_service == nullptr) return false;
+  warnIfTooLong(characteristic, length);
+  
+  NimBLECharacteristic* created_characteristic = createCharacteristic(characteristic);
+  CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (created_characteristic == nullptr || length > slot.max_length) return false;
+  
+  if (slot.published != nullptr) {
+    writePublished(*slot.published, data, length);
+  } else {
+    clearValueSource(slot);
+    created_characteristic->setValue(data, length);
+    stabilizeLongRead(characteristic);
+  }
+  refreshAdvertising(characteristic);
+  
+  return true;
+}
+
+/**
+ * @brief Serve a characteristic value straight from static or flash-resident storage
+ * @param characteristic The characteristic to set
+ * @param data The value; must stay valid and unchanged for as long as the service is registered
+ * @param length Length of the data in octets
+ * @return true if successful, false if service doesn't exist, the characteristic is outside the canonical layout, the value is longer than the characteristic allows or the characteristic takes concurrent updates
+ * @note BTDevInf keeps only the pointer and length, and copies the value into the characteristic at the first request of each read, since NimBLE answers reads from the characteristic's own buffer.
+ *       NimBLE allocates that buffer at up to 20 octets when the characteristic is created, so only values longer than that save RAM, and only until the first read: from then on the characteristic holds a copy.
+ * @note A characteristic created by this call is sized for exactly this value.
+ * @note The BTDevInf instance must outlive the service, since reads are answered through its read callback. This replaces any callbacks set on the characteristic.
+ */
+bool BTDevInf::setStaticValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length) {
+  warnIfTooLong(characteristic, length);
+  if (device_info_service == nullptr || length > BLE_ATT_ATTR_MAX_LEN) return false;
+  if (slots[static_cast<size_t>(characteristic)].published != nullptr) return false;
+  
+  NimBLECharacteristic* created_characteristic = createCharacteristic(characteristic, length);
+  CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (created_characteristic == nullptr || length > slot.max_length) return false;
+  
+  clearValueSource(slot);
+  slot.static_data = data;
+  slot.static_length = length;
+  created_characteristic->setCallbacks(&characteristic_callbacks);
+  refreshAdvertising(characteristic);
+  
+  return true;
+}
+
+/**
+ * @brief Serve a string characteristic value straight from static or flash-resident storage
+ * @param characteristic The characteristic to set
+ * @param value A null-terminated string, typically a literal; must stay valid for as long as the service is registered
+ * @return true if successful, false if service doesn't exist, the characteristic is outside the canonical layout or the value is longer than the characteristic allows
+ */
+bool BTDevInf::setStaticValue(BTDevInfCharacteristic characteristic, const char* value) {
+  return setStaticValue(characteristic, reinterpret_cast<const uint8_t*>(value), strlen(value));
+}
+
+/**
+ * @brief Serve a characteristic value from a pool shared with other BTDevInf instances
+ * @param characteristic The characteristic to set
+ * @param pool The pool to intern the value in; must outlive this instance
+ * @param data The value; copied into the pool unless the pool already holds it
+ * @param length Length of the data in octets
+ * @return true if successful, false if service doesn't exist, the characteristic is outside the canonical layout, the value is longer than the characteristic allows or the characteristic takes concurrent updates
+ * @note Works like setStaticValue() with storage owned by the pool: every instance set to the same value references one copy, which is released when this characteristic is set again or the instance is destroyed.
+ * @note NimBLE serves reads only from the characteristic's own value, so the first read copies the pooled value into it. Pooling saves memory only for characteristics that have not been read yet, such as across a fleet that is built but not yet connected to.
+ */
+bool BTDevInf::setPooledValue(BTDevInfCharacteristic characteristic, BTDevInfValuePool& pool, const uint8_t* data, size_t length) {
+  if (device_info_service == nullptr || length > BLE_ATT_ATTR_MAX_LEN) {
+    warnIfTooLong(characteristic, length);
+    return false;
+  }
   
-  characteristic_presentation_format_descriptor->setFormat(format);
-  characteristic_presentation_format_descriptor->setExponent(exponent);
-  characteristic_presentation_format_descriptor->setUnit(unit);
-  characteristic_presentation_format_descriptor->setNamespace(namespace_value);
-  characteristic_presentation_format_descriptor->setDescription(description);
+  BTDevInfPooledValue* value = pool.acquire(data, length);
+  if (!setStaticValue(characteristic, value->data, value->length)) {
+    BTDevInfValuePool::release(value);
+    return false;
+  }
+  slots[static_cast<size_t>(characteristic)].pooled = value;
+  
+  return true;
 }
 
-void BTDevInf::createSystemIDCharacteristic() {
-  if (device_info_service == nullptr || system_id_characteristic != nullptr) return;
+/**
+ * @brief Compute a characteristic value on the first client read instead of at boot
+ * @param characteristic The characteristic to set
+ * @param provider Called on the NimBLE host task the first time a client reads the characteristic; its result is cached in the characteristic
+ * @param context Passed to the provider unchanged
+ * @param max_length Largest value the provider returns; a characteristic created by this call is sized for it
+ * @return true if successful, false if service doesn't exist, the characteristic is outside the canonical layout, provider is null or the characteristic takes concurrent updates
+ * @note For characteristics that require authentication the provider only runs once a client has authenticated, so values most connections never read are never computed.
+ * @note The BTDevInf instance must outlive the service, since reads are answered through its read callback. This replaces any callbacks set on the characteristic.
+ */
+bool BTDevInf::setValueProvider(BTDevInfCharacteristic characteristic, BTDevInfValueProvider provider, void* context, uint16_t max_length) {
+  if (device_info_service == nullptr || provider == nullptr) return false;
+  if (slots[static_cast<size_t>(characteristic)].published != nullptr) return false;
+  if (max_length > BLE_ATT_ATTR_MAX_LEN) max_length = BLE_ATT_ATTR_MAX_LEN;
+  
+  NimBLECharacteristic* created_characteristic = createCharacteristic(characteristic, max_length);
+  CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (created_characteristic == nullptr) return false;
   
-  system_id_characteristic = device_info_service->getCharacteristic(SYSTEM_ID_CHARACTERISTIC_UUID);
-  if (system_id_characteristic == nullptr) {
-    system_id_characteristic = device_info_service->createCharacteristic(
-      SYSTEM_ID_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_AUTHEN
-    );
-    setupDescriptors(system_id_characteristic, "System ID", NimBLE2904::FORMAT_OPAQUE, 0x00, 0x0000, 0x01, 0x0000);
+  clearValueSource(slot);
+  slot.provider = provider;
+  slot.provider_context = context;
+  created_characteristic->setCallbacks(&characteristic_callbacks);
+  
+  return true;
+}
+
+/**
+ * @brief Drop the cached result of a value provider so that the next client read calls it again
+ * @param characteristic The characteristic whose provider should run again
+ * @note Safe to call from any task. Has no effect on characteristics without a provider.
+ */
+void BTDevInf::invalidateValue(BTDevInfCharacteristic characteristic) {
+  slots[static_cast<size_t>(characteristic)].provided = false;
+}
+
+/**
+ * @brief Let a characteristic be updated from any task while the NimBLE host task serves reads of it
+ * @param characteristic The characteristic to update concurrently, such as a revision string changed after OTA staging
+ * @param max_length Longest value it will be set to; a characteristic created by this call is sized for it, one that already exists keeps its size
+ * @return true if successful, false if service doesn't exist, the characteristic is outside the canonical layout or the characteristic has a value provider
+ * @note Call this while setting up the service. From then on setValue() and the named setters for this characteristic may be called from any task: they write the value into a double buffer without taking a lock and without touching the characteristic, and the host task copies the latest complete value into the characteristic when a client reads it, unless another connection is part-way through a long read, see enableStableLongReads(). Readers never wait and never see part of an update; concurrent writers take turns.
+ * @note The current value, if any, is kept. The BTDevInf instance must outlive the service, since reads are answered through its read callback. This replaces any callbacks set on the characteristic.
+ */
+bool BTDevInf::enableConcurrentUpdates(BTDevInfCharacteristic characteristic, uint16_t max_length) {
+  if (device_info_service == nullptr) return false;
+  if (max_length > BLE_ATT_ATTR_MAX_LEN) max_length = BLE_ATT_ATTR_MAX_LEN;
+  
+  NimBLECharacteristic* created_characteristic = createCharacteristic(characteristic, max_length);
+  CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (created_characteristic == nullptr) return false;
+  if (slot.published != nullptr) return true;
+  if (slot.provider != nullptr) return false;
+  
+  PublishedValue* published = new PublishedValue();
+  published->begin = 0;
+  published->end = 0;
+  published->lengths[0] = 0;
+  published->lengths[1] = 0;
+  published->word_count = (slot.max_length + 3) / 4;
+  published->words = new std::atomic<uint32_t>[2 * published->word_count]();
+  published->writing.clear();
+  published->read_buffer = new uint8_t[slot.max_length];
+  published->readers = 0;
+  published->read_until_ms = 0;
+  
+  size_t length;
+  if (getCurrentValue(characteristic, published->read_buffer, slot.max_length, length)) {
+    writePublished(*published, published->read_buffer, length);
   }
+  
+  clearValueSource(slot);
+  slot.published = published;
+  created_characteristic->setCallbacks(&characteristic_callbacks);
+  
+  return true;
 }
 
-void BTDevInf::createModelNumberStringCharacteristic() {
-  if (device_info_service == nullptr || model_number_string_characteristic != nullptr) return;
+/**
+ * @brief Serve every value that takes Read Blob requests from one copy per read, so a client never gets parts of two values
+ * @param mtu ATT_MTU to judge values by; values longer than mtu-1 octets are affected
+ * @return true if successful, false if service doesn't exist
+ * @note NimBLE answers every Read Blob from the characteristic value as it is at that moment, so a value set while a client is part-way through a long read reaches that client torn.
+ *       This enables concurrent updates, see enableConcurrentUpdates(), for each characteristic whose value is longer than mtu-1 octets, now and whenever a setter makes one that long later.
+ *       Its value is then copied into the characteristic only at the first request of a read, and the Read Blob requests that follow are served from that copy.
+ * @note Static values and value providers are already served this way and are left as they are.
+ * @note All connections read the one characteristic value, so a read that starts while another connection is part-way through a long read shares that read's copy instead of refreshing it; a value set meanwhile reaches clients once no long read is in progress.
+ *       A long read is taken to be in progress for four connection intervals per request; a client slower than that can still get a value torn by a read on another connection. Forward disconnects to onDisconnect() to end the reads of a closed connection early.
+ * @note Each affected characteristic holds its max length three times over; size long characteristics with Builder::setMaxLength() or enableConcurrentUpdates() beforehand to keep that small.
+ */
+bool BTDevInf::enableStableLongReads(uint16_t mtu) {
+  if (device_info_service == nullptr) return false;
   
-  model_number_string_characteristic = device_info_service->getCharacteristic(MODEL_NUMBER_STRING_CHARACTERISTIC_UUID);
-  if (model_number_string_characteristic == nullptr) {
-    model_number_string_characteristic = device_info_service->createCharacteristic(
-      MODEL_NUMBER_STRING_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ
-    );
-    setupDescriptors(model_number_string_characteristic, "Model Number", NimBLE2904::FORMAT_UTF8, 0x00, 0x0000, 0x01, 0x0000);
+  stable_read_mtu = mtu < BTDEVINF_DEFAULT_ATT_MTU ? BTDEVINF_DEFAULT_ATT_MTU : mtu;
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    stabilizeLongRead(static_cast<BTDevInfCharacteristic>(i));
   }
+  return true;
 }
 
-void BTDevInf::createSerialNumberStringCharacteristic() {
-  if (device_info_service == nullptr || serial_number_string_characteristic != nullptr) return;
+void BTDevInf::stabilizeLongRead(BTDevInfCharacteristic characteristic) {
+  const CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (stable_read_mtu == 0 || slot.characteristic == nullptr) return;
+  if (slot.published != nullptr || slot.static_data != nullptr || slot.provider != nullptr) return;
   
-  serial_number_string_characteristic = device_info_service->getCharacteristic(SERIAL_NUMBER_STRING_CHARACTERISTIC_UUID);
-  if (serial_number_string_characteristic == nullptr) {
-    serial_number_string_characteristic = device_info_service->createCharacteristic(
-      SERIAL_NUMBER_STRING_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_AUTHEN
-    );
-    setupDescriptors(serial_number_string_characteristic, "Serial Number", NimBLE2904::FORMAT_UTF8, 0x00, 0x0000, 0x01, 0x0000);
+  if (countReadRoundTrips(slot.characteristic->getAttVal().size(), stable_read_mtu) > 1) {
+    enableConcurrentUpdates(characteristic, slot.max_length);
+  }
+}
+
+/**
+ * @brief Number of ATT requests a client needs to read a characteristic value
+ * @param characteristic The characteristic to read
+ * @param mtu ATT_MTU of the connection; values below the minimum of 23 count as 23
+ * @return 1 for the Read plus one per Read Blob, or 0 if the characteristic doesn't exist
+ * @note A client sends Read Blob requests until a response is shorter than mtu-1 octets, so a value whose length is a multiple of mtu-1 costs one more request, answered with no octets.
+ * @note A value provider that has not run yet is counted at its max length, so the result is an upper bound until the first read.
+ */
+uint16_t BTDevInf::getReadRoundTrips(BTDevInfCharacteristic characteristic, uint16_t mtu) const {
+  const CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (slot.characteristic == nullptr) return 0;
+  return countReadRoundTrips(getValueLength(slot), mtu);
+}
+
+/**
+ * @brief Number of ATT requests a client needs to read every characteristic value managed by this instance
+ * @param mtu ATT_MTU of the connection
+ * @note Discovery is not included.
+ */
+uint16_t BTDevInf::getReadRoundTrips(uint16_t mtu) const {
+  uint16_t round_trips = 0;
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    round_trips += getReadRoundTrips(static_cast<BTDevInfCharacteristic>(i), mtu);
   }
+  return round_trips;
+}
+
+uint16_t BTDevInf::countReadRoundTrips(size_t length, uint16_t mtu) {
+  if (mtu < BTDEVINF_DEFAULT_ATT_MTU) mtu = BTDEVINF_DEFAULT_ATT_MTU;
+  return length / (mtu - 1) + 1;
 }
 
-void BTDevInf::createFirmwareRevisionStringCharacteristic() {
-  if (device_info_service == nullptr || firmware_revision_string_characteristic != nullptr) return;
+void BTDevInf::writePublished(PublishedValue& published, const uint8_t* data, size_t length) {
+  // A writer that finds another one mid-update sleeps a tick, so a lower priority writer can finish
+  while (published.writing.test_and_set(std::memory_order_acquire)) {
+    ble_npl_time_delay(1);
+  }
+  
+  // Announce the write before filling the buffer, so a reader of the previous value in this buffer retries
+  uint32_t sequence = published.begin.load(std::memory_order_relaxed) + 1;
+  published.begin.store(sequence, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
   
-  firmware_revision_string_characteristic = device_info_service->getCharacteristic(FIRMWARE_REVISION_STRING_CHARACTERISTIC_UUID);
-  if (firmware_revision_string_characteristic == nullptr) {
-    firmware_revision_string_characteristic = device_info_service->createCharacteristic(
-      FIRMWARE_REVISION_STRING_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ
-    );
-    setupDescriptors(firmware_revision_string_characteristic, "Firmware Revision", NimBLE2904::FORMAT_UTF8, 0x00, 0x0000, 0x01, 0x0000);
+  std::atomic<uint32_t>* words = published.words + (sequence & 1) * published.word_count;
+  for (size_t i = 0; i < length; i += 4) {
+    uint32_t word = 0;
+    for (size_t j = 0; j < 4 && i + j < length; j++) {
+      word |= static_cast<uint32_t>(data[i + j]) << (8 * j);
+    }
+    words[i / 4].store(word, std::memory_order_relaxed);
   }
+  published.lengths[sequence & 1].store(static_cast<uint16_t>(length), std::memory_order_relaxed);
+  published.end.store(sequence, std::memory_order_release);
+  
+  published.writing.clear(std::memory_order_release);
 }
 
-void BTDevInf::createHardwareRevisionStringCharacteristic() {
-  if (device_info_service == nullptr || hardware_revision_string_characteristic != nullptr) return;
+size_t BTDevInf::readPublished(const PublishedValue& published, uint8_t* buffer, size_t capacity) {
+  while (true) {
+    uint32_t sequence = published.end.load(std::memory_order_acquire);
+    const std::atomic<uint32_t>* words = published.words + (sequence & 1) * published.word_count;
+    size_t length = published.lengths[sequence & 1].load(std::memory_order_relaxed);
+    size_t copied = length < capacity ? length : capacity;
+    
+    for (size_t i = 0; i < copied; i += 4) {
+      uint32_t word = words[i / 4].load(std::memory_order_relaxed);
+      for (size_t j = 0; j < 4 && i + j < copied; j++) {
+        buffer[i + j] = static_cast<uint8_t>(word >> (8 * j));
+      }
+    }
+    
+    // The writer two sequence numbers on reuses this buffer; once it has started, the copy may be torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (published.begin.load(std::memory_order_relaxed) - sequence < 2) return length;
+  }
+}
+
+/**
+ * @brief Create every characteristic collected by a Builder in one pass
+ * @param builder The values to commit
+ * @return A report of what was created and how many attribute handles the service now uses
+ * @note Characteristics are created in BTDEVINF_CHARACTERISTIC_SPECS order, each sized for BLE_ATT_ATTR_MAX_LEN octets like those the setters create, or for the length given to Builder::setMaxLength().
+ * @note Characteristics that already exist are updated in place. A value longer than BLE_ATT_ATTR_MAX_LEN is skipped and the report marked unsuccessful, while the other values are still committed.
+ * @note A convenience over calling the setters in table order, not a faster path: each value goes through setValue() or setStaticValue(), and NimBLE sizes value buffers from the max length alone, so the allocations and setup time are those of the setters.
+ */
+BTDevInf::BuildReport BTDevInf::commit(const Builder& builder) {
+  BuildReport report = {false, 0, 0, 0};
+  if (device_info_service == nullptr) return report;
   
-  hardware_revision_string_characteristic = device_info_service->getCharacteristic(HARDWARE_REVISION_STRING_CHARACTERISTIC_UUID);
-  if (hardware_revision_string_characteristic == nullptr) {
-    hardware_revision_string_characteristic = device_info_service->createCharacteristic(
-      HARDWARE_REVISION_STRING_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ
-    );
-    setupDescriptors(hardware_revision_string_characteristic, "Hardware Revision", NimBLE2904::FORMAT_UTF8, 0x00, 0x0000, 0x01, 0x0000);
+  report.success = true;
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    const Builder::Field& field = builder.fields[i];
+    if (!field.is_set) continue;
+    if (field.is_too_long) {
+      report.success = false;
+      continue;
+    }
+    
+    BTDevInfCharacteristic characteristic = static_cast<BTDevInfCharacteristic>(i);
+    const uint8_t* data = field.data;
+    if (characteristic == BTDevInfCharacteristic::PNP_ID && data == nullptr) {
+      data = builder.pnp_id;
+    }
+    
+    uint16_t max_length = BLE_ATT_ATTR_MAX_LEN;
+    if (field.max_length != 0) max_length = field.max_length > field.length ? field.max_length : field.length;
+    
+    bool existed = slots[i].characteristic != nullptr;
+    createCharacteristic(characteristic, max_length);
+    if (!existed && slots[i].characteristic != nullptr) report.characteristic_count++;
+    
+    bool committed;
+    if (field.is_static) {
+      committed = setStaticValue(characteristic, data, field.length);
+    } else {
+      committed = setValue(characteristic, data, field.length);
+    }
+    
+    if (committed) {
+      report.value_bytes += field.length;
+    } else {
+      report.success = false;
+    }
   }
+  
+  report.attribute_count = getAttributeCount();
+  return report;
 }
 
-void BTDevInf::createSoftwareRevisionStringCharacteristic() {
-  if (device_info_service == nullptr || software_revision_string_characteristic != nullptr) return;
+/**
+ * @brief Number of attribute handles the characteristics managed by this instance use, including the service declaration
+ * @note Each characteristic uses a declaration and a value handle plus one handle per descriptor.
+ */
+uint16_t BTDevInf::getAttributeCount() const {
+  if (device_info_service == nullptr) return 0;
   
-  software_revision_string_characteristic = device_info_service->getCharacteristic(SOFTWARE_REVISION_STRING_CHARACTERISTIC_UUID);
-  if (software_revision_string_characteristic == nullptr) {
-    software_revision_string_characteristic = device_info_service->createCharacteristic(
-      SOFTWARE_REVISION_STRING_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ
-    );
-    setupDescriptors(software_revision_string_characteristic, "Software Revision", NimBLE2904::FORMAT_UTF8, 0x00, 0x0000, 0x01, 0x0000);
+  uint16_t count = 1;
+  for (const CharacteristicSlot& slot : slots) {
+    if (slot.characteristic != nullptr) count += 2 + slot.descriptor_count;
+  }
+  return count;
+}
+
+/**
+ * @brief Size of the snapshot saveSnapshot() would write now
+ * @note For characteristics with concurrent updates the value's max length is counted, so the result is enough even if the value grows meanwhile.
+ */
+size_t BTDevInf::getSnapshotSize() const {
+  size_t size = SNAPSHOT_HEADER_LENGTH + SNAPSHOT_CHECKSUM_LENGTH;
+  for (const CharacteristicSlot& slot : slots) {
+    if (slot.characteristic == nullptr || slot.provider != nullptr) continue;
+    
+    size += SNAPSHOT_ENTRY_LENGTH;
+    if (slot.published != nullptr) {
+      size += slot.max_length;
+    } else if (slot.static_data != nullptr) {
+      size += slot.static_length;
+    } else {
+      size += slot.characteristic->getAttVal().size();
+    }
   }
+  return size;
 }
 
-void BTDevInf::createManufacturerNameStringCharacteristic() {
-  if (device_info_service == nullptr || manufacturer_name_string_characteristic != nullptr) return;
+/**
+ * @brief Serialize the whole configuration, so it can be stored as one blob and restored at boot with restoreSnapshot()
+ * @param buffer Receives the snapshot, in BTDEVINF_SNAPSHOT_FORMAT_VERSION format
+ * @param capacity Size of buffer in octets, see getSnapshotSize()
+ * @return Length of the snapshot, or 0 if it does not fit
+ * @note Records each characteristic's value, properties, max length, descriptor policy and whether it takes concurrent updates. Static values are saved as values. Characteristics with a value provider are left out, since their values are computed on demand.
+ */
+size_t BTDevInf::saveSnapshot(uint8_t* buffer, size_t capacity) const {
+  if (buffer == nullptr || capacity < SNAPSHOT_HEADER_LENGTH + SNAPSHOT_CHECKSUM_LENGTH) return 0;
   
-  manufacturer_name_string_characteristic = device_info_service->getCharacteristic(MANUFACTURER_NAME_STRING_CHARACTERISTIC_UUID);
-  if (manufacturer_name_string_characteristic == nullptr) {
-    manufacturer_name_string_characteristic = device_info_service->createCharacteristic(
-      MANUFACTURER_NAME_STRING_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ
-    );
-    setupDescriptors(manufacturer_name_string_characteristic, "Manufacturer Name", NimBLE2904::FORMAT_UTF8, 0x00, 0x0000, 0x01, 0x0000);
+  size_t length = SNAPSHOT_HEADER_LENGTH;
+  uint8_t entry_count = 0;
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    const CharacteristicSlot& slot = slots[i];
+    if (slot.characteristic == nullptr || slot.provider != nullptr) continue;
+    if (length + SNAPSHOT_ENTRY_LENGTH + SNAPSHOT_CHECKSUM_LENGTH > capacity) return 0;
+    
+    // The value is copied in place after its entry header
+    uint8_t* entry = buffer + length;
+    size_t value_length;
+    if (!getCurrentValue(static_cast<BTDevInfCharacteristic>(i), entry + SNAPSHOT_ENTRY_LENGTH, capacity - length - SNAPSHOT_ENTRY_LENGTH - SNAPSHOT_CHECKSUM_LENGTH, value_length)) {
+      value_length = 0;
+    }
+    if (length + SNAPSHOT_ENTRY_LENGTH + value_length + SNAPSHOT_CHECKSUM_LENGTH > capacity) return 0;
+    
+    entry[0] = i;
+    entry[1] = static_cast<uint8_t>(slot.descriptor_policy) | (slot.published != nullptr ? SNAPSHOT_CONCURRENT_UPDATES : 0);
+    writeU16(entry + 2, BTDEVINF_CHARACTERISTIC_SPECS[i].properties);
+    writeU16(entry + 4, slot.max_length);
+    writeU16(entry + 6, value_length);
+    length += SNAPSHOT_ENTRY_LENGTH + value_length;
+    entry_count++;
   }
+  
+  memcpy(buffer, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  buffer[4] = BTDEVINF_SNAPSHOT_FORMAT_VERSION;
+  buffer[5] = entry_count;
+  writeU16(buffer + 6, length + SNAPSHOT_CHECKSUM_LENGTH);
+  writeU32(buffer + length, crc32(buffer, length));
+  
+  return length + SNAPSHOT_CHECKSUM_LENGTH;
 }
 
-void BTDevInf::createIEEERegulatoryCertificationDataListCharacteristic() {
-  if (device_info_service == nullptr || ieee_regulatory_certification_data_list_characteristic != nullptr) return;
+/**
+ * @brief Rebuild the configuration saved by saveSnapshot() in one pass
+ * @param snapshot The snapshot, typically read from NVS into one buffer; values are copied, so it can be released afterwards
+ * @param length Length of the snapshot in octets
+ * @return A report as from commit(); success is false and nothing is changed if the snapshot is damaged, from another format version or from a build with different characteristic properties
+ * @note The whole snapshot is checked before anything is created. Call this before startService(), in place of the setters.
+ */
+BTDevInf::BuildReport BTDevInf::restoreSnapshot(const uint8_t* snapshot, size_t length) {
+  BuildReport report = {false, 0, 0, 0};
+  if (device_info_service == nullptr || !validateSnapshot(snapshot, length)) return report;
   
-  ieee_regulatory_certification_data_list_characteristic = device_info_service->getCharacteristic(IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST_CHARACTERISTIC_UUID);
-  if (ieee_regulatory_certification_data_list_characteristic == nullptr) {
-    ieee_regulatory_certification_data_list_characteristic = device_info_service->createCharacteristic(
-      IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ
-    );
-    setupDescriptors(ieee_regulatory_certification_data_list_characteristic, "IEEE Regulatory Certification", NimBLE2904::FORMAT_IEEE20601, 0x00, 0x0000, 0x01, 0x0000);
+  Builder builder;
+  uint16_t concurrent = 0; // Enabled after commit(), which creates the characteristics in table order
+  size_t position = SNAPSHOT_HEADER_LENGTH;
+  for (uint8_t i = 0; i < snapshot[5]; i++) {
+    const uint8_t* entry = snapshot + position;
+    BTDevInfCharacteristic characteristic = static_cast<BTDevInfCharacteristic>(entry[0]);
+    uint16_t max_length = readU16(entry + 4);
+    uint16_t value_length = readU16(entry + 6);
+    
+    setDescriptorPolicy(characteristic, static_cast<BTDevInfDescriptorPolicy>(entry[1] & SNAPSHOT_DESCRIPTOR_POLICY_MASK));
+    if (entry[1] & SNAPSHOT_CONCURRENT_UPDATES) concurrent |= btdevinfCharacteristicBit(characteristic);
+    builder.setValue(characteristic, entry + SNAPSHOT_ENTRY_LENGTH, value_length).setMaxLength(characteristic, max_length);
+    position += SNAPSHOT_ENTRY_LENGTH + value_length;
   }
+  
+  report = commit(builder);
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    if ((concurrent & (1u << i)) && !enableConcurrentUpdates(static_cast<BTDevInfCharacteristic>(i))) report.success = false;
+  }
+  
+  return report;
 }
 
-void BTDevInf::createPnPIDCharacteristic() {
-  if (device_info_service == nullptr || pnp_id_characteristic != nullptr) return;
+/**
+ * @brief Check a snapshot's format version, length, checksum and entries without restoring it
+ */
+bool BTDevInf::validateSnapshot(const uint8_t* snapshot, size_t length) {
+  if (snapshot == nullptr || length < SNAPSHOT_HEADER_LENGTH + SNAPSHOT_CHECKSUM_LENGTH) return false;
+  if (memcmp(snapshot, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || snapshot[4] != BTDEVINF_SNAPSHOT_FORMAT_VERSION) return false;
+  if (readU16(snapshot + 6) != length) return false;
   
-  pnp_id_characteristic = device_info_service->getCharacteristic(PNP_ID_CHARACTERISTIC_UUID);
-  if (pnp_id_characteristic == nullptr) {
-    pnp_id_characteristic = device_info_service->createCharacteristic(
-      PNP_ID_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ
-    );
-    setupDescriptors(pnp_id_characteristic, "PnP ID", NimBLE2904::FORMAT_OPAQUE, 0x00, 0x0000, 0x01, 0x0000);
+  size_t end = length - SNAPSHOT_CHECKSUM_LENGTH;
+  if (crc32(snapshot, end) != readU32(snapshot + end)) return false;
+  
+  uint16_t seen = 0;
+  size_t position = SNAPSHOT_HEADER_LENGTH;
+  for (uint8_t i = 0; i < snapshot[5]; i++) {
+    if (position + SNAPSHOT_ENTRY_LENGTH > end) return false;
+    
+    const uint8_t* entry = snapshot + position;
+    uint8_t index = entry[0];
+    uint8_t flags = entry[1];
+    uint16_t max_length = readU16(entry + 4);
+    uint16_t value_length = readU16(entry + 6);
+    
+    if (index >= BTDEVINF_CHARACTERISTIC_COUNT || (seen & (1 << index))) return false;
+    if ((flags & ~(SNAPSHOT_DESCRIPTOR_POLICY_MASK | SNAPSHOT_CONCURRENT_UPDATES)) || (flags & SNAPSHOT_DESCRIPTOR_POLICY_MASK) > static_cast<uint8_t>(BTDevInfDescriptorPolicy::NONE)) return false;
+    if (readU16(entry + 2) != BTDEVINF_CHARACTERISTIC_SPECS[index].properties) return false;
+    if (max_length > BLE_ATT_ATTR_MAX_LEN || value_length > max_length) return false;
+    
+    seen |= 1 << index;
+    position += SNAPSHOT_ENTRY_LENGTH + value_length;
+  }
+  
+  return position == end;
+}
+
+uint32_t BTDevInf::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+    }
   }
+  return ~crc;
 }
 
-void BTDevInf::createUDIForMedicalDevicesCharacteristic() {
-  if (device_info_service == nullptr || udi_for_medical_devices_characteristic != nullptr) return;
+/**
+ * @brief Fix the characteristics of the service and their order, so attribute handles depend on nothing else
+ * @param characteristics The characteristics the service holds, as bits of BTDevInfCharacteristic (see btdevinfCharacteristicBit()), at least one
+ * @return true if successful, false if service doesn't exist, was not created by this instance, already holds characteristics or characteristics is 0
+ * @note Every listed characteristic is created right away, in BTDEVINF_CHARACTERISTIC_SPECS order and with its descriptor policy, so set descriptor policies first.
+ *       Setters of listed characteristics then only set values, and setters of other characteristics fail, so the handles are the same whichever setters run and in whatever order.
+ * @note Characteristics that are listed but never set are reserved: they keep their handles and read as empty, so a later firmware that sets them keeps every handle, and the GATT caches of bonded clients, valid.
+ * @note Characteristics are sized for BLE_ATT_ATTR_MAX_LEN octets; enableConcurrentUpdates() buffers follow that size.
+ */
+bool BTDevInf::enableCanonicalLayout(uint16_t characteristics) {
+  characteristics &= BTDEVINF_ALL_CHARACTERISTICS;
+  if (device_info_service == nullptr || !service_created || layout != 0 || characteristics == 0) return false;
+  for (const CharacteristicSlot& slot : slots) {
+    if (slot.characteristic != nullptr) return false;
+  }
   
-  udi_for_medical_devices_characteristic = device_info_service->getCharacteristic(UDI_FOR_MEDICAL_DEVICES_CHARACTERISTIC_UUID);
-  if (udi_for_medical_devices_characteristic == nullptr) {
-    udi_for_medical_devices_characteristic = device_info_service->createCharacteristic(
-      UDI_FOR_MEDICAL_DEVICES_CHARACTERISTIC_UUID,
-      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_AUTHEN
-    );
-    setupDescriptors(udi_for_medical_devices_characteristic, "UDI for Medical Devices", NimBLE2904::FORMAT_OPAQUE, 0x00, 0x0000, 0x01, 0x0000);
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    if (characteristics & (1u << i)) createCharacteristic(static_cast<BTDevInfCharacteristic>(i));
   }
+  layout = characteristics;
+  
+  return true;
+}
+
+/**
+ * @brief Hash of the Device Information Service's part of the attribute database
+ * @return CRC-32 over the attributes of the service in handle order, 0 if service doesn't exist
+ * @note Each attribute adds its offset from the service declaration and its type, and the service and characteristic declarations add their values (service UUID; properties, value offset and UUID of the characteristic).
+ *       As in the GATT Database Hash, characteristic and descriptor values are left out, so the hash changes exactly when a client's cached handles for this service would become wrong, and never when values change.
+ * @note Absolute handles also depend on the services registered before this one; the server's Database Hash, which Robust Caching clients compare on reconnect, covers the whole database. Comparing this hash across firmware builds shows whether the Device Information Service keeps its part of it unchanged.
+ */
+uint32_t BTDevInf::getLayoutHash() const {
+  if (device_info_service == nullptr) return 0;
+  
+  uint8_t record[38]; // Offset, type and declaration value of one attribute
+  size_t length;
+  uint16_t offset = 0;
+  
+  auto put16 = [&](uint16_t value) {
+    writeU16(record + length, value);
+    length += 2;
+  };
+  auto putUUID = [&](const NimBLEUUID& uuid) {
+    memcpy(record + length, uuid.getValue(), uuid.bitSize() / 8);
+    length += uuid.bitSize() / 8;
+  };
+  
+  length = 0;
+  put16(offset++);
+  put16(PRIMARY_SERVICE_UUID);
+  putUUID(device_info_service->getUUID());
+  uint32_t hash = crc32(record, length);
+  
+  for (const NimBLECharacteristic* characteristic : device_info_service->getCharacteristics()) {
+    length = 0;
+    put16(offset);
+    put16(CHARACTERISTIC_DECLARATION_UUID);
+    put16(characteristic->getProperties());
+    put16(offset + 1);
+    putUUID(characteristic->getUUID());
+    hash = crc32(record, length, hash);
+    offset++;
+    
+    length = 0;
+    put16(offset++);
+    putUUID(characteristic->getUUID());
+    hash = crc32(record, length, hash);
+    
+    for (const NimBLEDescriptor* descriptor : characteristic->getDescriptors()) {
+      length = 0;
+      put16(offset++);
+      putUUID(descriptor->getUUID());
+      hash = crc32(record, length, hash);
+    }
+  }
+  
+  return hash;
+}
+
+/**
+ * @brief Choose which descriptors are added to every characteristic created from now on
+ * @param policy FULL (0x2901 and 0x2904, the default), PRESENTATION_FORMAT_ONLY or NONE
+ * @note This overrides any per-characteristic policy set before. Characteristics that already exist keep their descriptors, so set the policy before the first setter or commit().
+ */
+void BTDevInf::setDescriptorPolicy(BTDevInfDescriptorPolicy policy) {
+  for (CharacteristicSlot& slot : slots) {
+    slot.descriptor_policy = policy;
+  }
+}
+
+/**
+ * @brief Choose which descriptors are added to one characteristic when it is created
+ * @param characteristic The characteristic the policy applies to
+ * @param policy FULL (0x2901 and 0x2904, the default), PRESENTATION_FORMAT_ONLY or NONE
+ * @note Has no effect if the characteristic already exists.
+ */
+void BTDevInf::setDescriptorPolicy(BTDevInfCharacteristic characteristic, BTDevInfDescriptorPolicy policy) {
+  slots[static_cast<size_t>(characteristic)].descriptor_policy = policy;
+}
+
+/**
+ * @brief Advertise the PnP ID, firmware revision and model number so scanners can identify the device without connecting
+ * @param advertising The advertising instance to update, usually NimBLEDevice::getAdvertising(); nullptr to stop updating it
+ * @param options Where to put the data, which fields to include and how much space they may use
+ * @return true if the advertising data was updated
+ * @note The data is rebuilt whenever a setter changes one of the advertised characteristics, and pushed to the controller if advertising is running. With BTDevInfAdvertisingSlot::SCAN_RESPONSE, BTDevInf replaces the whole scan response.
+ * @note Values from a value provider are not advertised, since they are only computed when a client reads them.
+ * @note The advertising data is rebuilt on the task that calls the setter. NimBLEAdvertising is not safe to update from two tasks at once, so characteristics with concurrent updates that are advertised should be set from one task at a time.
+ */
+bool BTDevInf::setAdvertising(NimBLEAdvertising* advertising, const BTDevInfAdvertisingOptions& options) {
+  this->advertising = advertising;
+  advertising_options = options;
+  if (advertising == nullptr) return true;
+  
+  return refreshAdvertising(BTDevInfCharacteristic::PNP_ID);
+}
+
+/**
+ * @brief Encode the advertised Device Information as manufacturer data
+ * @param buffer Receives the company ID followed by the fields, in BTDEVINF_ADVERTISING_FORMAT_VERSION format
+ * @param capacity Size of buffer in octets
+ * @param options Which fields to include and how much space they may use
+ * @return Length of the manufacturer data, without the AD structure's length and type octets, or 0 if it does not fit
+ * @note Fields are added in the order PnP ID, firmware revision, model number. Strings that do not fit are truncated and flagged as such; a string with no room left for any of it is left out.
+ * @note Use this directly to place the data in extended advertising, with options.max_length up to BTDEVINF_EXTENDED_ADVERTISING_LENGTH.
+ */
+size_t BTDevInf::buildManufacturerData(uint8_t* buffer, size_t capacity, const BTDevInfAdvertisingOptions& options) const {
+  size_t limit = options.max_length > BTDEVINF_EXTENDED_ADVERTISING_LENGTH ? BTDEVINF_EXTENDED_ADVERTISING_LENGTH : options.max_length;
+  limit = limit > 2 ? limit - 2 : 0;
+  if (capacity < limit) limit = capacity;
+  
+  // Company ID and header octet
+  if (buffer == nullptr || limit < 3) return 0;
+  
+  uint8_t pnp_id[7];
+  size_t pnp_id_length;
+  bool has_pnp_id = (options.fields & BTDEVINF_ADVERTISE_PNP_ID) && getCurrentValue(BTDevInfCharacteristic::PNP_ID, pnp_id, sizeof(pnp_id), pnp_id_length) && pnp_id_length == 7;
+  
+  uint16_t company_id = options.company_id;
+  if (has_pnp_id && pnp_id[0] == 0x01) company_id = pnp_id[1] | (pnp_id[2] << 8);
+  buffer[0] = company_id & 0xFF;
+  buffer[1] = (company_id >> 8) & 0xFF;
+  
+  uint8_t header = BTDEVINF_ADVERTISING_FORMAT_VERSION << 5;
+  size_t length = 3;
+  
+  if (has_pnp_id) {
+    if (length + 7 > limit) return 0;
+    memcpy(buffer + length, pnp_id, 7);
+    length += 7;
+    header |= BTDEVINF_ADVERTISE_PNP_ID;
+  }
+  
+  const struct {
+    uint8_t field;
+    BTDevInfCharacteristic characteristic;
+    uint8_t truncated;
+  } strings[] = {
+    {BTDEVINF_ADVERTISE_FIRMWARE_REVISION, BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, BTDEVINF_ADVERTISING_FIRMWARE_TRUNCATED},
+    {BTDEVINF_ADVERTISE_MODEL_NUMBER, BTDevInfCharacteristic::MODEL_NUMBER_STRING, BTDEVINF_ADVERTISING_MODEL_TRUNCATED}
+  };
+  
+  for (const auto& string : strings) {
+    if (!(options.fields & string.field)) continue;
+    if (length + 1 >= limit) break;
+    
+    // The string is copied in place after its length octet
+    size_t data_length;
+    if (!getCurrentValue(string.characteristic, buffer + length + 1, limit - length - 1, data_length)) continue;
+    
+    size_t fitted = data_length < limit - length - 1 ? data_length : limit - length - 1;
+    buffer[length++] = fitted;
+    length += fitted;
+    header |= string.field;
+    if (fitted < data_length) header |= string.truncated;
+  }
+  
+  buffer[2] = header;
+  return length;
+}
+
+size_t BTDevInf::getValueLength(const CharacteristicSlot& slot) {
+  if (slot.published != nullptr) {
+    return slot.published->lengths[slot.published->end.load(std::memory_order_acquire) & 1].load(std::memory_order_relaxed);
+  }
+  if (slot.static_data != nullptr) return slot.static_length;
+  if (slot.provider != nullptr && !slot.provided) return slot.max_length;
+  return slot.characteristic->getAttVal().size();
+}
+
+bool BTDevInf::getCurrentValue(BTDevInfCharacteristic characteristic, uint8_t* buffer, size_t capacity, size_t& length) const {
+  const CharacteristicSlot& slot = slots[static_cast<size_t>(characteristic)];
+  if (slot.published != nullptr) {
+    length = readPublished(*slot.published, buffer, capacity);
+    return length > 0;
+  }
+  
+  const uint8_t* data;
+  if (slot.static_data != nullptr) {
+    data = slot.static_data;
+    length = slot.static_length;
+  } else {
+    if (slot.characteristic == nullptr || slot.provider != nullptr) return false;
+    data = slot.characteristic->getAttVal().data();
+    length = slot.characteristic->getAttVal().size();
+    if (length == 0) return false;
+  }
+  
+  memcpy(buffer, data, length < capacity ? length : capacity);
+  return true;
+}
+
+bool BTDevInf::refreshAdvertising(BTDevInfCharacteristic changed) {
+  if (advertising == nullptr) return false;
+  if (changed != BTDevInfCharacteristic::PNP_ID && changed != BTDevInfCharacteristic::FIRMWARE_REVISION_STRING && changed != BTDevInfCharacteristic::MODEL_NUMBER_STRING) return false;
+  
+  uint8_t manufacturer_data[BTDEVINF_EXTENDED_ADVERTISING_LENGTH];
+  size_t length = buildManufacturerData(manufacturer_data, sizeof(manufacturer_data), advertising_options);
+  if (length == 0) return false;
+  
+  bool updated;
+  if (advertising_options.slot == BTDevInfAdvertisingSlot::SCAN_RESPONSE) {
+    NimBLEAdvertisementData scan_response;
+    updated = scan_response.setManufacturerData(manufacturer_data, length) && advertising->setScanResponseData(scan_response);
+    advertising->enableScanResponse(true);
+  } else {
+    updated = advertising->setManufacturerData(manufacturer_data, length);
+  }
+  
+  if (updated && advertising->isAdvertising()) advertising->refreshAdvertisingData();
+  return updated;
+}
+
+/**
+ * @brief Start counting reads of every Device Information characteristic
+ * @note Installs BTDevInf's read callback on all characteristics it manages, replacing any callbacks set on them, so the BTDevInf instance must outlive the service. Counters are updated on the NimBLE host task without locks.
+ * @note connection_count counts each connection once, at its first read of the characteristic. NimBLE reuses connection handles, so forward disconnects to onDisconnect() for a central that reconnects to count again.
+ * @note Reads are only seen by BTDevInf once the stack has accepted them. NimBLE rejects reads of READ_AUTHEN characteristics from unauthenticated links before any callback runs, so those are not counted.
+ */
+void BTDevInf::enableInstrumentation() {
+  if (read_counters != nullptr) return;
+  
+  read_counters = new ReadCounters[BTDEVINF_CHARACTERISTIC_COUNT];
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    read_counters[i].read_count = 0;
+    read_counters[i].connection_count = 0;
+    read_counters[i].last_read_ms = 0;
+    read_counters[i].reading_connections = 0;
+    if (slots[i].characteristic != nullptr) slots[i].characteristic->setCallbacks(&characteristic_callbacks);
+  }
+}
+
+/**
+ * @brief End a connection for the read counters and for long reads in progress, so the next connection with its handle counts as a new one
+ * @param conn_info The connection that ended
+ * @note Call this from the application's NimBLEServerCallbacks::onDisconnect(); BTDevInf does not install server callbacks, since a server has only one set. Without it, every connection that reuses a handle counts as the one that read first, and a long read cut off by the disconnect keeps other connections on its copy until it would have ended.
+ */
+void BTDevInf::onDisconnect(const NimBLEConnInfo& conn_info) {
+  uint32_t connection_bit = 1u << (conn_info.getConnHandle() % 32);
+  for (CharacteristicSlot& slot : slots) {
+    if (slot.published != nullptr) slot.published->readers &= ~connection_bit;
+  }
+  if (read_counters == nullptr) return;
+  
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    read_counters[i].reading_connections.fetch_and(~connection_bit, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Copy the read counters and memory accounting of all characteristics
+ * @param snapshot Receives the counters
+ * @return true if instrumentation is enabled; memory accounting is filled in either way
+ * @note Cheap enough to poll periodically from another task: it only loads atomics and value lengths and does not allocate.
+ */
+bool BTDevInf::getInstrumentationSnapshot(InstrumentationSnapshot& snapshot) const {
+  snapshot.value_bytes = 0;
+  snapshot.descriptor_bytes = 0;
+  snapshot.static_bytes = 0;
+  snapshot.published_bytes = 0;
+  
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    const CharacteristicSlot& slot = slots[i];
+    CharacteristicStats& stats = snapshot.characteristics[i];
+    
+    if (read_counters != nullptr) {
+      stats.read_count = read_counters[i].read_count.load(std::memory_order_relaxed);
+      stats.connection_count = read_counters[i].connection_count.load(std::memory_order_relaxed);
+      stats.last_read_ms = read_counters[i].last_read_ms.load(std::memory_order_relaxed);
+    } else {
+      stats.read_count = 0;
+      stats.connection_count = 0;
+      stats.last_read_ms = 0;
+    }
+    
+    stats.value_bytes = 0;
+    stats.descriptor_bytes = 0;
+    stats.published_bytes = 0;
+    if (slot.characteristic != nullptr) {
+      stats.value_bytes = slot.characteristic->getAttVal().capacity();
+      // 0x2904 holds 7 octets, 0x2901 the user description text
+      if (slot.descriptor_count > 0) stats.descriptor_bytes += 7;
+      if (slot.descriptor_count > 1) stats.descriptor_bytes += strlen(BTDEVINF_CHARACTERISTIC_SPECS[i].user_description);
+    }
+    if (slot.published != nullptr) {
+      stats.published_bytes = sizeof(PublishedValue) + 2 * slot.published->word_count * sizeof(uint32_t) + slot.max_length;
+    }
+    
+    snapshot.value_bytes += stats.value_bytes;
+    snapshot.descriptor_bytes += stats.descriptor_bytes;
+    snapshot.published_bytes += stats.published_bytes;
+    snapshot.static_bytes += slot.static_data != nullptr ? slot.static_length : 0;
+  }
+  
+  return read_counters != nullptr;
+}
+
+void BTDevInf::encodePnPID(uint8_t (&pnp)[7], uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version) {
+  pnp[0] = vendor_id_source;
+  pnp[1] = static_cast<uint8_t>(vendor_id & 0xFF);
+  pnp[2] = static_cast<uint8_t>((vendor_id >> 8) & 0xFF);
+  pnp[3] = static_cast<uint8_t>(product_id & 0xFF);
+  pnp[4] = static_cast<uint8_t>((product_id >> 8) & 0xFF);
+  pnp[5] = static_cast<uint8_t>(product_version & 0xFF);
+  pnp[6] = static_cast<uint8_t>((product_version >> 8) & 0xFF);
+}
+
+BTDevInf::Builder::Builder() {
+  for (Field& field : fields) {
+    field = {nullptr, 0, 0, false, false, false};
+  }
+}
+
+/**
+ * @brief Add a value to copy into its characteristic on commit
+ * @param characteristic The characteristic to set
+ * @param data The value; referenced until commit
+ * @param length Length of the data in octets, at most BLE_ATT_ATTR_MAX_LEN
+ * @note A longer value is not committed and makes commit() report failure, as the setters reject it.
+ */
+BTDevInf::Builder& BTDevInf::Builder::setValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length) {
+  warnIfTooLong(characteristic, length);
+  Field& field = fields[static_cast<size_t>(characteristic)];
+  field.is_too_long = length > BLE_ATT_ATTR_MAX_LEN;
+  field.data = field.is_too_long ? nullptr : data;
+  field.length = field.is_too_long ? 0 : length;
+  field.is_set = true;
+  field.is_static = false;
+  return *this;
+}
+
+/**
+ * @brief Add a value to serve from static storage, see BTDevInf::setStaticValue()
+ */
+BTDevInf::Builder& BTDevInf::Builder::setStaticValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length) {
+  setValue(characteristic, data, length);
+  fields[static_cast<size_t>(characteristic)].is_static = true;
+  return *this;
+}
+
+/**
+ * @brief Size a characteristic for values up to max_length octets instead of BLE_ATT_ATTR_MAX_LEN
+ * @note Later updates to the characteristic cannot be longer than this, nor can enableConcurrentUpdates() raise it. A max_length below the committed value's length is raised to that length; 0 restores the default.
+ * @note Use this to keep the buffers of concurrent updates and stable long reads small, which are allocated for the max length.
+ */
+BTDevInf::Builder& BTDevInf::Builder::setMaxLength(BTDevInfCharacteristic characteristic, uint16_t max_length) {
+  fields[static_cast<size_t>(characteristic)].max_length = max_length > BLE_ATT_ATTR_MAX_LEN ? BLE_ATT_ATTR_MAX_LEN : max_length;
+  return *this;
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setSystemID(const uint8_t* system_id, size_t length) {
+  return setValue(BTDevInfCharacteristic::SYSTEM_ID, system_id, length);
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setModelNumberString(const char* model_number_string) {
+  return setValue(BTDevInfCharacteristic::MODEL_NUMBER_STRING, reinterpret_cast<const uint8_t*>(model_number_string), strlen(model_number_string));
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setSerialNumberString(const char* serial_number_string) {
+  return setValue(BTDevInfCharacteristic::SERIAL_NUMBER_STRING, reinterpret_cast<const uint8_t*>(serial_number_string), strlen(serial_number_string));
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setFirmwareRevisionString(const char* firmware_revision_string) {
+  return setValue(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, reinterpret_cast<const uint8_t*>(firmware_revision_string), strlen(firmware_revision_string));
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setHardwareRevisionString(const char* hardware_revision_string) {
+  return setValue(BTDevInfCharacteristic::HARDWARE_REVISION_STRING, reinterpret_cast<const uint8_t*>(hardware_revision_string), strlen(hardware_revision_string));
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setSoftwareRevisionString(const char* software_revision_string) {
+  return setValue(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, reinterpret_cast<const uint8_t*>(software_revision_string), strlen(software_revision_string));
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setManufacturerNameString(const char* manufacturer_name_string) {
+  return setValue(BTDevInfCharacteristic::MANUFACTURER_NAME_STRING, reinterpret_cast<const uint8_t*>(manufacturer_name_string), strlen(manufacturer_name_string));
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setIEEERegulatoryCertificationDataList(const uint8_t* data, size_t length) {
+  return setValue(BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST, data, length);
+}
+
+/**
+ * @brief Add the PnP ID; the 7-byte value is kept inside the Builder
+ */
+BTDevInf::Builder& BTDevInf::Builder::setPnPID(uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version) {
+  encodePnPID(pnp_id, vendor_id_source, vendor_id, product_id, product_version);
+  // A null pointer makes commit() use pnp_id, so copies of the Builder stay valid
+  setValue(BTDevInfCharacteristic::PNP_ID, nullptr, sizeof(pnp_id));
+  return *this;
+}
+
+BTDevInf::Builder& BTDevInf::Builder::setUDIForMedicalDevices(const uint8_t* udi, size_t length) {
+  return setValue(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES, udi, length);
 }
 
 /**
@@ -195,13 +1151,7 @@ void BTDevInf::createUDIForMedicalDevicesCharacteristic() {
  * @note For more information about the System ID characteristic, see https://btprodspecificationrefs.blob.core.windows.net/gatt-specification-supplement/GATT_Specification_Supplement.pdf#page=168&zoom=100,96,296
  */
 bool BTDevInf::setSystemID(const uint8_t* system_id, size_t length) {
-  if (device_info_service == nullptr) return false;
-  
-  createSystemIDCharacteristic();
-  
-  system_id_characteristic->setValue(system_id, length);
-  
-  return true;
+  return setValue(BTDevInfCharacteristic::SYSTEM_ID, system_id, length);
 }
 
 /**
@@ -210,14 +1160,8 @@ bool BTDevInf::setSystemID(const uint8_t* system_id, size_t length) {
  * @return true if successful, false if service doesn't exist
  * @note This characteristic represents the model number that is assigned by the device vendor.
  */
-bool BTDevInf::setModelNumberString(const std::string& model_number_string) {
-  if (device_info_service == nullptr) return false;
-  
-  createModelNumberStringCharacteristic();
-  
-  model_number_string_characteristic->setValue(model_number_string);
-  
-  return true;
+bool BTDevInf::setModelNumberString(std::string_view model_number_string) {
+  return setValue(BTDevInfCharacteristic::MODEL_NUMBER_STRING, reinterpret_cast<const uint8_t*>(model_number_string.data()), model_number_string.size());
 }
 
 /**
@@ -226,14 +1170,8 @@ bool BTDevInf::setModelNumberString(const std::string& model_number_string) {
  * @return true if successful, false if service doesn't exist
  * @note This characteristic represents the serial number for a particular instance of the device.
  */
-bool BTDevInf::setSerialNumberString(const std::string& serial_number_string) {
-  if (device_info_service == nullptr) return false;
-  
-  createSerialNumberStringCharacteristic();
-  
-  serial_number_string_characteristic->setValue(serial_number_string);
-  
-  return true;
+bool BTDevInf::setSerialNumberString(std::string_view serial_number_string) {
+  return setValue(BTDevInfCharacteristic::SERIAL_NUMBER_STRING, reinterpret_cast<const uint8_t*>(serial_number_string.data()), serial_number_string.size());
 }
 
 /**
@@ -242,14 +1180,8 @@ bool BTDevInf::setSerialNumberString(const std::string& serial_number_string) {
  * @return true if successful, false if service doesn't exist
  * @note This characteristic represents a revision identifier for the firmware within the device.
  */
-bool BTDevInf::setFirmwareRevisionString(const std::string& firmware_revision_string) {
-  if (device_info_service == nullptr) return false;
-  
-  createFirmwareRevisionStringCharacteristic();
-  
-  firmware_revision_string_characteristic->setValue(firmware_revision_string);
-  
-  return true;
+bool BTDevInf::setFirmwareRevisionString(std::string_view firmware_revision_string) {
+  return setValue(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, reinterpret_cast<const uint8_t*>(firmware_revision_string.data()), firmware_revision_string.size());
 }
 
 /**
@@ -258,14 +1190,8 @@ bool BTDevInf::setFirmwareRevisionString(const std::string& firmware_revision_st
  * @return true if successful, false if service doesn't exist
  * @note This characteristic represents the hardware revision for the hardware within the device.
  */
-bool BTDevInf::setHardwareRevisionString(const std::string& hardware_revision_string) {
-  if (device_info_service == nullptr) return false;
-  
-  createHardwareRevisionStringCharacteristic();
-  
-  hardware_revision_string_characteristic->setValue(hardware_revision_string);
-  
-  return true;
+bool BTDevInf::setHardwareRevisionString(std::string_view hardware_revision_string) {
+  return setValue(BTDevInfCharacteristic::HARDWARE_REVISION_STRING, reinterpret_cast<const uint8_t*>(hardware_revision_string.data()), hardware_revision_string.size());
 }
 
 /**
@@ -274,14 +1200,8 @@ bool BTDevInf::setHardwareRevisionString(const std::string& hardware_revision_st
  * @return true if successful, false if service doesn't exist
  * @note This characteristic represents the software revision for the software within the device.
  */
-bool BTDevInf::setSoftwareRevisionString(const std::string& software_revision_string) {
-  if (device_info_service == nullptr) return false;
-  
-  createSoftwareRevisionStringCharacteristic();
-  
-  software_revision_string_characteristic->setValue(software_revision_string);
-  
-  return true;
+bool BTDevInf::setSoftwareRevisionString(std::string_view software_revision_string) {
+  return setValue(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, reinterpret_cast<const uint8_t*>(software_revision_string.data()), software_revision_string.size());
 }
 
 /**
@@ -290,14 +1210,8 @@ bool BTDevInf::setSoftwareRevisionString(const std::string& software_revision_st
  * @return true if successful, false if service doesn't exist
  * @note This characteristic represents the name of the manufacturer of the device. This value is set by the manufacturer or supplier of the device.
  */
-bool BTDevInf::setManufacturerNameString(const std::string& manufacturer_name_string) {
-  if (device_info_service == nullptr) return false;
-  
-  createManufacturerNameStringCharacteristic();
-  
-  manufacturer_name_string_characteristic->setValue(manufacturer_name_string);
-  
-  return true;
+bool BTDevInf::setManufacturerNameString(std::string_view manufacturer_name_string) {
+  return setValue(BTDevInfCharacteristic::MANUFACTURER_NAME_STRING, reinterpret_cast<const uint8_t*>(manufacturer_name_string.data()), manufacturer_name_string.size());
 }
 
 /**
@@ -307,17 +1221,12 @@ bool BTDevInf::setManufacturerNameString(const std::string& manufacturer_name_st
  * @return true if successful, false if service doesn't exist
  * @note The content of this characteristic is determined by the authorizing organization that provides certifications
  * @note Refer to IEEE 11073-20601-2019 or later, or Continua Design Guidelines for more information on the format of this list
+ * @note BTDevInfRegulatoryEncoder in BTDevInfRegulatory.h builds this list without allocating, and BTDevInfRegulatoryDecoder reads it on the client side
  * @note IEEE Health informatics--Personal health device communication - Part 20601: Application profile--Optimized Exchange Protocol; https://standards.ieee.org/ieee/11073-20601/6084/
  * @note Continua Design Guidelines - Personal Connected Health Alliance; https://www.pchalliance.org/continua-design-guidelines
  */
 bool BTDevInf::setIEEERegulatoryCertificationDataList(const uint8_t* data, size_t length) {
-  if (device_info_service == nullptr) return false;
-  
-  createIEEERegulatoryCertificationDataListCharacteristic();
-  
-  ieee_regulatory_certification_data_list_characteristic->setValue(data, length);
-  
-  return true;
+  return setValue(BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST, data, length);
 }
 
 /**
@@ -344,22 +1253,10 @@ bool BTDevInf::setIEEERegulatoryCertificationDataList(const uint8_t* data, size_
  * @note The vendors themselves manage Product Version field values.
  */
 bool BTDevInf::setPnPID(uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version) {
-  if (device_info_service == nullptr) return false;
-  
-  createPnPIDCharacteristic();
+  uint8_t pnp[7];
+  encodePnPID(pnp, vendor_id_source, vendor_id, product_id, product_version);
   
-  uint8_t pnp[] = {
-    vendor_id_source,
-    static_cast<uint8_t>(vendor_id & 0xFF),
-    static_cast<uint8_t>((vendor_id >> 8) & 0xFF),
-    static_cast<uint8_t>(product_id & 0xFF),
-    static_cast<uint8_t>((product_id >> 8) & 0xFF),
-    static_cast<uint8_t>(product_version & 0xFF),
-    static_cast<uint8_t>((product_version >> 8) & 0xFF)
-  };
-  pnp_id_characteristic->setValue(pnp, sizeof(pnp));
-  
-  return true;
+  return setValue(BTDevInfCharacteristic::PNP_ID, pnp, sizeof(pnp));
 }
 
 /**
@@ -371,11 +1268,5 @@ bool BTDevInf::setPnPID(uint8_t vendor_id_source, uint16_t vendor_id, uint16_t p
  * @note The UDI of a personal medical device is seen as Protected Health Information.
  */
 bool BTDevInf::setUDIForMedicalDevices(const uint8_t* udi, size_t length) {
-  if (device_info_service == nullptr) return false;
-  
-  createUDIForMedicalDevicesCharacteristic();
-  
-  udi_for_medical_devices_characteristic->setValue(udi, length);
-  
-  return true;
+  return setValue(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES, udi, length);
 }
\ No newline at end of file
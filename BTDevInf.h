@@ -1,20 +1,168 @@
 #ifndef BTDEVINF_H
 #define BTDEVINF_H
 
+#if __cplusplus < 201703L
+#error "BTDevInf requires C++17 (arduino-esp32 3.x, ESP-IDF 5.x); with arduino-esp32 2.x add -std=gnu++17 to build_flags and -std=gnu++11 to build_unflags"
+#endif
+
 #include <NimBLEDevice.h>
 
-const NimBLEUUID DEVICE_INFORMATION_SERVICE_UUID("180A");
+#include <atomic>
+#include <string_view>
+#if __has_include(<span>)
+#include <span>
+#endif
+
+/**
+ * @brief Device Information Service, characteristic and descriptor UUIDs
+ * @note These are plain 16-bit constants rather than NimBLEUUID objects, so including this header adds no static initializers and no per translation unit copies. They convert to NimBLEUUID wherever NimBLE expects one.
+ */
+inline constexpr uint16_t DEVICE_INFORMATION_SERVICE_UUID = 0x180A;
+
+inline constexpr uint16_t SYSTEM_ID_CHARACTERISTIC_UUID = 0x2A23;
+inline constexpr uint16_t MODEL_NUMBER_STRING_CHARACTERISTIC_UUID = 0x2A24;
+inline constexpr uint16_t SERIAL_NUMBER_STRING_CHARACTERISTIC_UUID = 0x2A25;
+inline constexpr uint16_t FIRMWARE_REVISION_STRING_CHARACTERISTIC_UUID = 0x2A26;
+inline constexpr uint16_t HARDWARE_REVISION_STRING_CHARACTERISTIC_UUID = 0x2A27;
+inline constexpr uint16_t SOFTWARE_REVISION_STRING_CHARACTERISTIC_UUID = 0x2A28;
+inline constexpr uint16_t MANUFACTURER_NAME_STRING_CHARACTERISTIC_UUID = 0x2A29;
+inline constexpr uint16_t IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST_CHARACTERISTIC_UUID = 0x2A2A;
+inline constexpr uint16_t PNP_ID_CHARACTERISTIC_UUID = 0x2A50;
+inline constexpr uint16_t UDI_FOR_MEDICAL_DEVICES_CHARACTERISTIC_UUID = 0x2BFF;
+
+inline constexpr uint16_t CHARACTERISTIC_USER_DESCRIPTION_DESCRIPTOR_UUID = 0x2901;
+inline constexpr uint16_t CHARACTERISTIC_PRESENTATION_FORMAT_DESCRIPTOR_UUID = 0x2904;
+
+/**
+ * @brief Characteristics of the Device Information Service
+ * @note The order matches BTDEVINF_CHARACTERISTIC_SPECS and is the order used wherever characteristics are enumerated.
+ */
+enum class BTDevInfCharacteristic : uint8_t {
+  SYSTEM_ID,
+  MODEL_NUMBER_STRING,
+  SERIAL_NUMBER_STRING,
+  FIRMWARE_REVISION_STRING,
+  HARDWARE_REVISION_STRING,
+  SOFTWARE_REVISION_STRING,
+  MANUFACTURER_NAME_STRING,
+  IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST,
+  PNP_ID,
+  UDI_FOR_MEDICAL_DEVICES
+};
+
+/**
+ * @brief Compile-time description of one Device Information characteristic
+ * @note Depending on the BTDevInfDescriptorPolicy, characteristics get a User Description (0x2901) and a Presentation Format (0x2904) descriptor; the 2904 exponent, unit and description are 0 and the namespace is 0x01 (Bluetooth SIG) for all of them.
+ */
+struct BTDevInfCharacteristicSpec {
+  uint16_t uuid;
+  uint16_t properties;
+  uint8_t format;
+  const char* user_description;
+};
+
+/**
+ * @brief Characteristic registry, indexed by BTDevInfCharacteristic
+ * @note Adding a characteristic to the service is one row here plus its BTDevInfCharacteristic entry.
+ */
+inline constexpr BTDevInfCharacteristicSpec BTDEVINF_CHARACTERISTIC_SPECS[] = {
+  {SYSTEM_ID_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_AUTHEN, NimBLE2904::FORMAT_OPAQUE, "System ID"},
+  {MODEL_NUMBER_STRING_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ, NimBLE2904::FORMAT_UTF8, "Model Number"},
+  {SERIAL_NUMBER_STRING_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_AUTHEN, NimBLE2904::FORMAT_UTF8, "Serial Number"},
+  {FIRMWARE_REVISION_STRING_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ, NimBLE2904::FORMAT_UTF8, "Firmware Revision"},
+  {HARDWARE_REVISION_STRING_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ, NimBLE2904::FORMAT_UTF8, "Hardware Revision"},
+  {SOFTWARE_REVISION_STRING_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ, NimBLE2904::FORMAT_UTF8, "Software Revision"},
+  {MANUFACTURER_NAME_STRING_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ, NimBLE2904::FORMAT_UTF8, "Manufacturer Name"},
+  {IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ, NimBLE2904::FORMAT_IEEE20601, "IEEE Regulatory Certification"},
+  {PNP_ID_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ, NimBLE2904::FORMAT_OPAQUE, "PnP ID"},
+  {UDI_FOR_MEDICAL_DEVICES_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_AUTHEN, NimBLE2904::FORMAT_OPAQUE, "UDI for Medical Devices"}
+};
+
+inline constexpr size_t BTDEVINF_CHARACTERISTIC_COUNT = sizeof(BTDEVINF_CHARACTERISTIC_SPECS) / sizeof(BTDEVINF_CHARACTERISTIC_SPECS[0]);
+
+static_assert(BTDEVINF_CHARACTERISTIC_COUNT == static_cast<size_t>(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES) + 1, "BTDEVINF_CHARACTERISTIC_SPECS must have one row per BTDevInfCharacteristic");
+
+/**
+ * @brief Sets of characteristics as bit masks, bit n for BTDevInfCharacteristic n, see BTDevInf::enableCanonicalLayout()
+ */
+inline constexpr uint16_t btdevinfCharacteristicBit(BTDevInfCharacteristic characteristic) { return 1u << static_cast<uint8_t>(characteristic); }
+inline constexpr uint16_t BTDEVINF_ALL_CHARACTERISTICS = (1u << BTDEVINF_CHARACTERISTIC_COUNT) - 1;
+
+/**
+ * @brief Which descriptors BTDevInf adds to a characteristic it creates
+ * @note Each descriptor costs one attribute handle and has to be walked by clients during descriptor discovery on every connection that does not cache the database.
+ */
+enum class BTDevInfDescriptorPolicy : uint8_t {
+  FULL,                     // User Description (0x2901) and Presentation Format (0x2904)
+  PRESENTATION_FORMAT_ONLY, // Presentation Format (0x2904) only
+  NONE                      // No descriptors
+};
+
+uint8_t btdevinfCreateDescriptors(NimBLECharacteristic* characteristic, const BTDevInfCharacteristicSpec& spec, BTDevInfDescriptorPolicy policy);
+
+/**
+ * @brief Computes a characteristic value when a client first reads it
+ * @param buffer Receives the value
+ * @param capacity Size of buffer in octets
+ * @param context The pointer given to BTDevInf::setValueProvider()
+ * @return Length of the value written to buffer, at most capacity
+ */
+typedef size_t (*BTDevInfValueProvider)(uint8_t* buffer, size_t capacity, void* context);
+
+/**
+ * @brief Where BTDevInf puts its manufacturer data when advertising Device Information
+ */
+enum class BTDevInfAdvertisingSlot : uint8_t {
+  ADVERTISEMENT, // Added to the advertising data next to the fields the application sets
+  SCAN_RESPONSE  // The whole scan response, which BTDevInf then owns
+};
+
+/**
+ * @brief Fields BTDevInf can advertise, for BTDevInfAdvertisingOptions::fields
+ */
+inline constexpr uint8_t BTDEVINF_ADVERTISE_PNP_ID = 0x01;
+inline constexpr uint8_t BTDEVINF_ADVERTISE_FIRMWARE_REVISION = 0x02;
+inline constexpr uint8_t BTDEVINF_ADVERTISE_MODEL_NUMBER = 0x04;
+
+/**
+ * @brief Format of the advertised Device Information, after the 2-octet company ID of the manufacturer data:
+ *        a header octet (bits 0-2 fields present as BTDEVINF_ADVERTISE_*, bit 3 firmware revision truncated, bit 4 model number truncated, bits 5-7 format version),
+ *        the 7-octet PnP ID as in the PnP ID characteristic, then the firmware revision and the model number, each as a length octet followed by the string
+ */
+inline constexpr uint8_t BTDEVINF_ADVERTISING_FORMAT_VERSION = 1;
+inline constexpr uint8_t BTDEVINF_ADVERTISING_FIRMWARE_TRUNCATED = 0x08;
+inline constexpr uint8_t BTDEVINF_ADVERTISING_MODEL_TRUNCATED = 0x10;
+
+inline constexpr uint16_t BTDEVINF_LEGACY_ADVERTISING_LENGTH = 31;   // Legacy advertising or scan response payload
+inline constexpr uint16_t BTDEVINF_EXTENDED_ADVERTISING_LENGTH = 256; // One AD structure, the most a length octet can describe
 
-const NimBLEUUID SYSTEM_ID_CHARACTERISTIC_UUID("2A23");
-const NimBLEUUID MODEL_NUMBER_STRING_CHARACTERISTIC_UUID("2A24");
-const NimBLEUUID SERIAL_NUMBER_STRING_CHARACTERISTIC_UUID("2A25");
-const NimBLEUUID FIRMWARE_REVISION_STRING_CHARACTERISTIC_UUID("2A26");
-const NimBLEUUID HARDWARE_REVISION_STRING_CHARACTERISTIC_UUID("2A27");
-const NimBLEUUID SOFTWARE_REVISION_STRING_CHARACTERISTIC_UUID("2A28");
-const NimBLEUUID MANUFACTURER_NAME_STRING_CHARACTERISTIC_UUID("2A29");
-const NimBLEUUID IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST_CHARACTERISTIC_UUID("2A2A");
-const NimBLEUUID PNP_ID_CHARACTERISTIC_UUID("2A50");
-const NimBLEUUID UDI_FOR_MEDICAL_DEVICES_CHARACTERISTIC_UUID("2BFF");
+/**
+ * @brief How BTDevInf advertises Device Information, see BTDevInf::setAdvertising()
+ */
+struct BTDevInfAdvertisingOptions {
+  BTDevInfAdvertisingSlot slot = BTDevInfAdvertisingSlot::SCAN_RESPONSE;
+  uint8_t fields = BTDEVINF_ADVERTISE_PNP_ID | BTDEVINF_ADVERTISE_FIRMWARE_REVISION | BTDEVINF_ADVERTISE_MODEL_NUMBER;
+  uint16_t max_length = BTDEVINF_LEGACY_ADVERTISING_LENGTH; // Octets the manufacturer data AD structure may use, its length and type octets included
+  uint16_t company_id = 0xFFFF; // Used unless the PnP ID vendor ID source is the Bluetooth SIG, in which case the vendor ID is the company ID
+};
+
+/**
+ * @brief ATT_MTU every connection starts with, before any MTU exchange
+ * @note A Read returns at most ATT_MTU-1 octets of a value; a client reads the rest with one Read Blob request per further ATT_MTU-1 octets, see BTDevInf::getReadRoundTrips().
+ */
+inline constexpr uint16_t BTDEVINF_DEFAULT_ATT_MTU = 23;
+
+/**
+ * @brief Format of BTDevInf::saveSnapshot(), all integers little endian:
+ *        an 8-octet header ("BDIS", u8 format version, u8 entry count, u16 length of the whole snapshot),
+ *        one entry per characteristic (u8 BTDevInfCharacteristic, u8 flags, u16 properties, u16 max length, u16 value length, then the value),
+ *        then the CRC-32 (IEEE 802.3) of everything before it
+ * @note Entry flags: bits 0-1 the BTDevInfDescriptorPolicy, bit 2 set if concurrent updates are enabled
+ */
+inline constexpr uint8_t BTDEVINF_SNAPSHOT_FORMAT_VERSION = 1;
+
+class BTDevInfValuePool;
+struct BTDevInfPooledValue;
 
 /**
  * @brief Device Information Service class
@@ -24,59 +172,234 @@ const NimBLEUUID UDI_FOR_MEDICAL_DEVICES_CHARACTERISTIC_UUID("2BFF");
  */
 class BTDevInf {
   public:
+    /**
+     * @brief Collects Device Information values so they can be committed to a BTDevInf in one pass
+     * @note A convenience for collecting a whole profile, such as from configuration, and getting a report of it; it costs the same as the setters.
+     * @note Values are referenced, not copied, until BTDevInf::commit(); the buffers passed in must stay valid until then. Values added with setStaticValue() stay referenced afterwards, as with BTDevInf::setStaticValue().
+     */
+    class Builder {
+      public:
+        Builder();
+        
+        Builder& setValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length);
+        Builder& setStaticValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length);
+        Builder& setMaxLength(BTDevInfCharacteristic characteristic, uint16_t max_length);
+        
+        Builder& setSystemID(const uint8_t* system_id, size_t length);
+        Builder& setModelNumberString(const char* model_number_string);
+        Builder& setSerialNumberString(const char* serial_number_string);
+        Builder& setFirmwareRevisionString(const char* firmware_revision_string);
+        Builder& setHardwareRevisionString(const char* hardware_revision_string);
+        Builder& setSoftwareRevisionString(const char* software_revision_string);
+        Builder& setManufacturerNameString(const char* manufacturer_name_string);
+        Builder& setIEEERegulatoryCertificationDataList(const uint8_t* data, size_t length);
+        Builder& setPnPID(uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version);
+        Builder& setUDIForMedicalDevices(const uint8_t* udi, size_t length);
+        
+      private:
+        friend class BTDevInf;
+        
+        struct Field {
+          const uint8_t* data;
+          uint16_t length;
+          uint16_t max_length; // 0 for BLE_ATT_ATTR_MAX_LEN
+          bool is_set;
+          bool is_static;
+          bool is_too_long; // Rejected by commit(), as by the setters
+        };
+        
+        Field fields[BTDEVINF_CHARACTERISTIC_COUNT];
+        uint8_t pnp_id[7];
+    };
+    
+    /**
+     * @brief Outcome of BTDevInf::commit()
+     */
+    struct BuildReport {
+      bool success;
+      uint8_t characteristic_count; // Characteristics created by the commit
+      uint16_t attribute_count;     // Attribute handles the service uses for the characteristics managed by this instance, including the service declaration
+      size_t value_bytes;           // Octets of characteristic values committed
+    };
+    
+    /**
+     * @brief Read statistics and memory use of one characteristic, see BTDevInf::getInstrumentationSnapshot()
+     */
+    struct CharacteristicStats {
+      uint32_t read_count;            // Reads served, counting a long read (Read plus Read Blobs) once
+      uint32_t connection_count;      // Connections that read the characteristic at least once, see BTDevInf::onDisconnect()
+      uint32_t last_read_ms;          // ble_npl_time in milliseconds of the last read, 0 if never read
+      uint16_t value_bytes;           // Capacity of the characteristic value buffer, which may exceed the value length
+      uint16_t descriptor_bytes;      // Octets held in the descriptor values BTDevInf added
+      uint16_t published_bytes;       // Octets allocated for concurrent updates: both value copies, the host task copy and their bookkeeping
+    };
+    
+    /**
+     * @brief Point-in-time copy of the instrumentation counters
+     */
+    struct InstrumentationSnapshot {
+      CharacteristicStats characteristics[BTDEVINF_CHARACTERISTIC_COUNT]; // Indexed by BTDevInfCharacteristic
+      size_t value_bytes;      // Sum of the characteristic value buffer capacities
+      size_t descriptor_bytes; // Sum of descriptor value octets
+      size_t published_bytes;  // Sum of the octets allocated for concurrent updates
+      size_t static_bytes;     // Octets referenced in caller-owned storage through setStaticValue(), not held
+    };
+    
     BTDevInf(NimBLEServer* server);
+    ~BTDevInf();
+    BTDevInf(const BTDevInf&) = delete;
+    BTDevInf& operator=(const BTDevInf&) = delete;
+    
     bool startService();
     
+    BuildReport commit(const Builder& builder);
+    uint16_t getAttributeCount() const;
+    
+    bool enableCanonicalLayout(uint16_t characteristics = BTDEVINF_ALL_CHARACTERISTICS);
+    uint32_t getLayoutHash() const;
+    
+    size_t getSnapshotSize() const;
+    size_t saveSnapshot(uint8_t* buffer, size_t capacity) const;
+    BuildReport restoreSnapshot(const uint8_t* snapshot, size_t length);
+    static bool validateSnapshot(const uint8_t* snapshot, size_t length);
+    
+    void setDescriptorPolicy(BTDevInfDescriptorPolicy policy);
+    void setDescriptorPolicy(BTDevInfCharacteristic characteristic, BTDevInfDescriptorPolicy policy);
+    
+    bool setAdvertising(NimBLEAdvertising* advertising, const BTDevInfAdvertisingOptions& options = BTDevInfAdvertisingOptions());
+    size_t buildManufacturerData(uint8_t* buffer, size_t capacity, const BTDevInfAdvertisingOptions& options = BTDevInfAdvertisingOptions()) const;
+    
+    void enableInstrumentation();
+    bool getInstrumentationSnapshot(InstrumentationSnapshot& snapshot) const;
+    void onDisconnect(const NimBLEConnInfo& conn_info);
+    
+    bool setValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length);
+    bool setStaticValue(BTDevInfCharacteristic characteristic, const uint8_t* data, size_t length);
+    bool setStaticValue(BTDevInfCharacteristic characteristic, const char* value);
+    bool setPooledValue(BTDevInfCharacteristic characteristic, BTDevInfValuePool& pool, const uint8_t* data, size_t length);
+    bool setPooledValue(BTDevInfCharacteristic characteristic, BTDevInfValuePool& pool, std::string_view value) { return setPooledValue(characteristic, pool, reinterpret_cast<const uint8_t*>(value.data()), value.size()); }
+    bool setValueProvider(BTDevInfCharacteristic characteristic, BTDevInfValueProvider provider, void* context = nullptr, uint16_t max_length = BLE_ATT_ATTR_MAX_LEN);
+    void invalidateValue(BTDevInfCharacteristic characteristic);
+    bool enableConcurrentUpdates(BTDevInfCharacteristic characteristic, uint16_t max_length = BLE_ATT_ATTR_MAX_LEN);
+    bool enableStableLongReads(uint16_t mtu = BTDEVINF_DEFAULT_ATT_MTU);
+    
+    uint16_t getReadRoundTrips(BTDevInfCharacteristic characteristic, uint16_t mtu) const;
+    uint16_t getReadRoundTrips(uint16_t mtu) const;
+    
     bool setSystemID(const uint8_t* system_id, size_t length);
-    bool setModelNumberString(const std::string& model_number_string);
-    bool setSerialNumberString(const std::string& serial_number_string);
-    bool setFirmwareRevisionString(const std::string& firmware_revision_string);
-    bool setHardwareRevisionString(const std::string& hardware_revision_string);
-    bool setSoftwareRevisionString(const std::string& software_revision_string);
-    bool setManufacturerNameString(const std::string& manufacturer_name_string);
+    bool setModelNumberString(std::string_view model_number_string);
+    bool setSerialNumberString(std::string_view serial_number_string);
+    bool setFirmwareRevisionString(std::string_view firmware_revision_string);
+    bool setHardwareRevisionString(std::string_view hardware_revision_string);
+    bool setSoftwareRevisionString(std::string_view software_revision_string);
+    bool setManufacturerNameString(std::string_view manufacturer_name_string);
     bool setIEEERegulatoryCertificationDataList(const uint8_t* data, size_t length);
     bool setPnPID(uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version);
     bool setUDIForMedicalDevices(const uint8_t* udi, size_t length);
+    bool setUDIForMedicalDevices(std::string_view udi) { return setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(udi.data()), udi.size()); }
+    
+    // Strings held in char buffers that are not null-terminated
+    bool setModelNumberString(const char* model_number_string, size_t length) { return setModelNumberString(std::string_view(model_number_string, length)); }
+    bool setSerialNumberString(const char* serial_number_string, size_t length) { return setSerialNumberString(std::string_view(serial_number_string, length)); }
+    bool setFirmwareRevisionString(const char* firmware_revision_string, size_t length) { return setFirmwareRevisionString(std::string_view(firmware_revision_string, length)); }
+    bool setHardwareRevisionString(const char* hardware_revision_string, size_t length) { return setHardwareRevisionString(std::string_view(hardware_revision_string, length)); }
+    bool setSoftwareRevisionString(const char* software_revision_string, size_t length) { return setSoftwareRevisionString(std::string_view(software_revision_string, length)); }
+    bool setManufacturerNameString(const char* manufacturer_name_string, size_t length) { return setManufacturerNameString(std::string_view(manufacturer_name_string, length)); }
+    
+#ifdef __cpp_lib_span
+    bool setValue(BTDevInfCharacteristic characteristic, std::span<const uint8_t> data) { return setValue(characteristic, data.data(), data.size()); }
+    bool setSystemID(std::span<const uint8_t> system_id) { return setSystemID(system_id.data(), system_id.size()); }
+    bool setIEEERegulatoryCertificationDataList(std::span<const uint8_t> data) { return setIEEERegulatoryCertificationDataList(data.data(), data.size()); }
+    bool setUDIForMedicalDevices(std::span<const uint8_t> udi) { return setUDIForMedicalDevices(udi.data(), udi.size()); }
+#endif
     
     NimBLEService* getService() { return device_info_service; }
     
-    NimBLECharacteristic* getSystemIDCharacteristic() { return system_id_characteristic; }
-    NimBLECharacteristic* getModelNumberStringCharacteristic() { return model_number_string_characteristic; }
-    NimBLECharacteristic* getSerialNumberStringCharacteristic() { return serial_number_string_characteristic; }
-    NimBLECharacteristic* getFirmwareRevisionStringCharacteristic() { return firmware_revision_string_characteristic; }
-    NimBLECharacteristic* getHardwareRevisionStringCharacteristic() { return hardware_revision_string_characteristic; }
-    NimBLECharacteristic* getSoftwareRevisionStringCharacteristic() { return software_revision_string_characteristic; }
-    NimBLECharacteristic* getManufacturerNameStringCharacteristic() { return manufacturer_name_string_characteristic; }
-    NimBLECharacteristic* getIEEERegulatoryCertificationDataListCharacteristic() { return ieee_regulatory_certification_data_list_characteristic; }
-    NimBLECharacteristic* getPnPIDCharacteristic() { return pnp_id_characteristic; }
-    NimBLECharacteristic* getUDIForMedicalDevicesCharacteristic() { return udi_for_medical_devices_characteristic; }
+    NimBLECharacteristic* getCharacteristic(BTDevInfCharacteristic characteristic) { return slots[static_cast<size_t>(characteristic)].characteristic; }
+    
+    NimBLECharacteristic* getSystemIDCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::SYSTEM_ID); }
+    NimBLECharacteristic* getModelNumberStringCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::MODEL_NUMBER_STRING); }
+    NimBLECharacteristic* getSerialNumberStringCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::SERIAL_NUMBER_STRING); }
+    NimBLECharacteristic* getFirmwareRevisionStringCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING); }
+    NimBLECharacteristic* getHardwareRevisionStringCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::HARDWARE_REVISION_STRING); }
+    NimBLECharacteristic* getSoftwareRevisionStringCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING); }
+    NimBLECharacteristic* getManufacturerNameStringCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::MANUFACTURER_NAME_STRING); }
+    NimBLECharacteristic* getIEEERegulatoryCertificationDataListCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST); }
+    NimBLECharacteristic* getPnPIDCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::PNP_ID); }
+    NimBLECharacteristic* getUDIForMedicalDevicesCharacteristic() { return getCharacteristic(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES); }
     
   private:
+    class CharacteristicCallbacks : public NimBLECharacteristicCallbacks {
+      public:
+        CharacteristicCallbacks(BTDevInf* device_info) : device_info(device_info) {}
+        void onRead(NimBLECharacteristic* characteristic, NimBLEConnInfo& conn_info) override;
+        
+      private:
+        BTDevInf* device_info;
+    };
+    
+    /**
+     * @brief A value double buffer that application tasks write and the host task reads without a lock
+     * @note Writers fill the buffer the previous write did not use, then publish it through end. A reader copies buffer end & 1 and retries only if begin shows that a later writer has started reusing that buffer meanwhile.
+     */
+    struct PublishedValue {
+      std::atomic<uint32_t> begin; // Sequence number of the last write started
+      std::atomic<uint32_t> end;   // Sequence number of the last write completed; its value is in buffer end & 1
+      std::atomic<uint16_t> lengths[2];
+      std::atomic<uint32_t>* words; // Both buffers, word_count words each, copied a word at a time
+      uint16_t word_count;
+      std::atomic_flag writing; // Serializes writers; readers never touch it
+      uint8_t* read_buffer; // Host task copy of the value, max_length octets
+      uint32_t readers;       // Connections part-way through a long read of the characteristic value, one bit per handle modulo 32; host task only
+      uint32_t read_until_ms; // When the long reads in progress are taken to have ended; host task only
+    };
+    
+    struct CharacteristicSlot {
+      NimBLECharacteristic* characteristic;
+      const uint8_t* static_data; // Set while the value is served from caller-owned storage
+      uint16_t static_length;
+      BTDevInfPooledValue* pooled; // Set while static_data points into a BTDevInfValuePool
+      uint16_t max_length; // Value length the characteristic was created for
+      BTDevInfValueProvider provider; // Set while the value is computed on first read
+      void* provider_context;
+      std::atomic<bool> provided; // The provider's result is cached in the characteristic
+      BTDevInfDescriptorPolicy descriptor_policy; // Applied when the characteristic is created
+      uint8_t descriptor_count; // Descriptors BTDevInf added to the characteristic
+      PublishedValue* published; // Set once concurrent updates are enabled
+    };
+    
+    struct ReadCounters {
+      std::atomic<uint32_t> read_count;
+      std::atomic<uint32_t> connection_count;
+      std::atomic<uint32_t> last_read_ms;
+      std::atomic<uint32_t> reading_connections; // Bit per connection handle, modulo 32, set by its first read and cleared when it disconnects
+    };
+    
     NimBLEService* device_info_service;
+    bool service_created; // The service was created by this instance, so it holds no characteristics from elsewhere
+    ReadCounters* read_counters; // One per characteristic once instrumentation is enabled
+    NimBLEAdvertising* advertising; // Kept in sync with the advertised characteristics when set
+    BTDevInfAdvertisingOptions advertising_options;
+    CharacteristicCallbacks characteristic_callbacks;
+    uint16_t stable_read_mtu; // Values that take Read Blob requests at this MTU get concurrent updates, 0 if not enabled
+    uint16_t layout; // Characteristics of the canonical layout as bits of BTDevInfCharacteristic, 0 if characteristics are created as they are set
+    
+    CharacteristicSlot slots[BTDEVINF_CHARACTERISTIC_COUNT];
+    
+    NimBLECharacteristic* createCharacteristic(BTDevInfCharacteristic characteristic, uint16_t max_length = BLE_ATT_ATTR_MAX_LEN);
+    CharacteristicSlot* findSlot(const NimBLECharacteristic* characteristic);
+    void recordRead(const CharacteristicSlot& slot, const NimBLEConnInfo& conn_info);
+    static void clearValueSource(CharacteristicSlot& slot);
+    static void writePublished(PublishedValue& published, const uint8_t* data, size_t length);
+    static size_t readPublished(const PublishedValue& published, uint8_t* buffer, size_t capacity);
+    bool getCurrentValue(BTDevInfCharacteristic characteristic, uint8_t* buffer, size_t capacity, size_t& length) const;
+    static size_t getValueLength(const CharacteristicSlot& slot);
+    void stabilizeLongRead(BTDevInfCharacteristic characteristic);
+    static uint16_t countReadRoundTrips(size_t length, uint16_t mtu);
+    bool refreshAdvertising(BTDevInfCharacteristic changed);
     
-    NimBLECharacteristic* system_id_characteristic;
-    NimBLECharacteristic* model_number_string_characteristic;
-    NimBLECharacteristic* serial_number_string_characteristic;
-    NimBLECharacteristic* firmware_revision_string_characteristic;
-    NimBLECharacteristic* hardware_revision_string_characteristic;
-    NimBLECharacteristic* software_revision_string_characteristic;
-    NimBLECharacteristic* manufacturer_name_string_characteristic;
-    NimBLECharacteristic* ieee_regulatory_certification_data_list_characteristic;
-    NimBLECharacteristic* pnp_id_characteristic;
-    NimBLECharacteristic* udi_for_medical_devices_characteristic;
-    
-    void setupDescriptors(NimBLECharacteristic* characteristic, const char* user_description, uint8_t format, int8_t exponent, uint16_t unit, uint8_t namespace_value, uint16_t description);
-    
-    void createSystemIDCharacteristic();
-    void createModelNumberStringCharacteristic();
-    void createSerialNumberStringCharacteristic();
-    void createFirmwareRevisionStringCharacteristic();
-    void createHardwareRevisionStringCharacteristic();
-    void createSoftwareRevisionStringCharacteristic();
-    void createManufacturerNameStringCharacteristic();
-    void createIEEERegulatoryCertificationDataListCharacteristic();
-    void createPnPIDCharacteristic();
-    void createUDIForMedicalDevicesCharacteristic();
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+    static void encodePnPID(uint8_t (&pnp)[7], uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version);
 };
 
 #endif // BTDEVINF_H
\ No newline at end of file
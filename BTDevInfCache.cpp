@@ -0,0 +1,412 @@
+#include "BTDevInfCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if BTDEVINF_CACHE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(BTDEVINF_CHARACTERISTIC_COUNT == 10, "Cache records hold 10 value lengths; a new characteristic needs a new FORMAT_VERSION");
+
+namespace {
+  const uint8_t MAGIC[4] = {'B', 'D', 'I', 'C'};
+  const size_t NO_POSITION = SIZE_MAX;
+  
+  // Record field offsets
+  const size_t RECORD_ADDRESS = 0;
+  const size_t RECORD_ADDRESS_TYPE = 6;
+  const size_t RECORD_SYSTEM_ID = 8;
+  const size_t RECORD_PNP_ID = 16;
+  const size_t RECORD_DATA_OFFSET = 24;
+  const size_t RECORD_PRESENT = 28;
+  const size_t RECORD_LENGTHS = 30;
+  
+  uint16_t readU16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+  }
+  
+  uint32_t readU32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+  }
+  
+  void writeU16(uint8_t* data, uint16_t value) {
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+  }
+  
+  void writeU32(uint8_t* data, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      data[i] = (value >> (8 * i)) & 0xFF;
+    }
+  }
+  
+  void writeHeader(uint8_t* data, uint32_t record_count, uint32_t data_size) {
+    memcpy(data, MAGIC, sizeof(MAGIC));
+    writeU16(data + 4, BTDevInfCache::FORMAT_VERSION);
+    writeU16(data + 6, BTDevInfCache::RECORD_SIZE);
+    writeU32(data + 8, record_count);
+    writeU32(data + 12, data_size);
+  }
+}
+
+/**
+ * @brief Construct an empty cache
+ */
+BTDevInfCache::BTDevInfCache() {
+  image_data = nullptr;
+  image_size = 0;
+  mapping = nullptr;
+  mapping_size = 0;
+  clear();
+}
+
+BTDevInfCache::~BTDevInfCache() {
+  releaseMapping();
+}
+
+/**
+ * @brief Remove all records
+ */
+void BTDevInfCache::clear() {
+  releaseMapping();
+  image.assign(HEADER_SIZE, 0);
+  writeHeader(image.data(), 0, 0);
+  image_data = image.data();
+  image_size = image.size();
+}
+
+/**
+ * @brief Get the number of cached peers
+ */
+size_t BTDevInfCache::getRecordCount() const {
+  return readU32(image_data + 8);
+}
+
+int BTDevInfCache::compareAddress(const uint8_t* record, const NimBLEAddress& address) {
+  // Most significant octet first, then the address type
+  const uint8_t* value = address.getVal();
+  for (int i = 5; i >= 0; i--) {
+    if (record[RECORD_ADDRESS + i] != value[i]) return record[RECORD_ADDRESS + i] < value[i] ? -1 : 1;
+  }
+  if (record[RECORD_ADDRESS_TYPE] != address.getType()) return record[RECORD_ADDRESS_TYPE] < address.getType() ? -1 : 1;
+  return 0;
+}
+
+/**
+ * @brief Binary search for an address
+ * @return The position of the record if found, otherwise the position a record for the address would be inserted at
+ */
+int BTDevInfCache::findPosition(const NimBLEAddress& address, bool& found) const {
+  const uint8_t* records = image_data + HEADER_SIZE;
+  int low = 0;
+  int high = getRecordCount();
+  
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    int comparison = compareAddress(records + middle * RECORD_SIZE, address);
+    if (comparison == 0) {
+      found = true;
+      return middle;
+    }
+    if (comparison < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  
+  found = false;
+  return low;
+}
+
+void BTDevInfCache::decodeRecord(size_t position, BTDevInfCacheRecord& record) const {
+  const uint8_t* entry = image_data + HEADER_SIZE + position * RECORD_SIZE;
+  const uint8_t* data = image_data + HEADER_SIZE + getRecordCount() * RECORD_SIZE + readU32(entry + RECORD_DATA_OFFSET);
+  
+  record.address = entry + RECORD_ADDRESS;
+  record.address_type = entry[RECORD_ADDRESS_TYPE];
+  record.system_id = entry + RECORD_SYSTEM_ID;
+  record.pnp_id = entry + RECORD_PNP_ID;
+  record.present = readU16(entry + RECORD_PRESENT);
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    record.lengths[i] = readU16(entry + RECORD_LENGTHS + 2 * i);
+    record.values[i] = data;
+    data += record.lengths[i];
+  }
+}
+
+/**
+ * @brief Look up the record of a peer address
+ * @return true if the cache holds a record for the address
+ */
+bool BTDevInfCache::find(const NimBLEAddress& address, BTDevInfCacheRecord& record) const {
+  bool found;
+  int position = findPosition(address, found);
+  if (!found) return false;
+  
+  decodeRecord(position, record);
+  return true;
+}
+
+/**
+ * @brief Look up the record of a peer address, requiring its identity to match as well
+ * @param system_id The 8-octet System ID the record must hold, or nullptr to accept any
+ * @param pnp_id The 7-octet PnP ID the record must hold, or nullptr to accept any
+ * @note Guards against a different device reusing an address the cache has seen before.
+ */
+bool BTDevInfCache::find(const NimBLEAddress& address, const uint8_t* system_id, const uint8_t* pnp_id, BTDevInfCacheRecord& record) const {
+  if (!find(address, record)) return false;
+  if (system_id != nullptr && memcmp(record.system_id, system_id, 8) != 0) return false;
+  if (pnp_id != nullptr && memcmp(record.pnp_id, pnp_id, 7) != 0) return false;
+  return true;
+}
+
+/**
+ * @brief Look up a record by System ID and PnP ID alone, for peers that came back with a new address
+ * @note A linear scan over the records.
+ */
+bool BTDevInfCache::findByIdentity(const uint8_t* system_id, const uint8_t* pnp_id, BTDevInfCacheRecord& record) const {
+  size_t record_count = getRecordCount();
+  for (size_t i = 0; i < record_count; i++) {
+    const uint8_t* entry = image_data + HEADER_SIZE + i * RECORD_SIZE;
+    if (system_id != nullptr && memcmp(entry + RECORD_SYSTEM_ID, system_id, 8) != 0) continue;
+    if (pnp_id != nullptr && memcmp(entry + RECORD_PNP_ID, pnp_id, 7) != 0) continue;
+    decodeRecord(i, record);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Store the values a client has read, replacing any record for the same address
+ * @param address The peer address the values were read from
+ * @param client A client after BTDevInfClient::read()
+ */
+bool BTDevInfCache::store(const NimBLEAddress& address, const BTDevInfClient& client) {
+  bool found;
+  int position = findPosition(address, found);
+  return rebuild(found ? position : NO_POSITION, &address, &client);
+}
+
+/**
+ * @brief Remove the record of a peer address
+ * @return true if a record was removed
+ */
+bool BTDevInfCache::invalidate(const NimBLEAddress& address) {
+  bool found;
+  int position = findPosition(address, found);
+  if (!found) return false;
+  
+  return rebuild(position, nullptr, nullptr);
+}
+
+/**
+ * @brief Remove the record of a peer address if its firmware revision differs from the one given
+ * @param firmware_revision The peer's current Firmware Revision String, for example from its advertising data
+ * @return true if a record was removed
+ */
+bool BTDevInfCache::invalidateIfFirmwareChanged(const NimBLEAddress& address, const char* firmware_revision, size_t length) {
+  BTDevInfCacheRecord record;
+  if (!find(address, record)) return false;
+  
+  size_t index = static_cast<size_t>(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING);
+  if (record.lengths[index] == length && memcmp(record.values[index], firmware_revision, length) == 0) return false;
+  
+  return invalidate(address);
+}
+
+/**
+ * @brief Build a new image from the current one, leaving out the record at skip_position and adding one for address
+ */
+bool BTDevInfCache::rebuild(size_t skip_position, const NimBLEAddress* address, const BTDevInfClient* client) {
+  size_t record_count = getRecordCount();
+  size_t new_count = record_count - (skip_position != NO_POSITION ? 1 : 0) + (address != nullptr ? 1 : 0);
+  
+  size_t data_size = 0;
+  for (size_t i = 0; i < record_count; i++) {
+    if (i == skip_position) continue;
+    BTDevInfCacheRecord record;
+    decodeRecord(i, record);
+    for (size_t c = 0; c < BTDEVINF_CHARACTERISTIC_COUNT; c++) data_size += record.lengths[c];
+  }
+  if (client != nullptr) {
+    for (size_t c = 0; c < BTDEVINF_CHARACTERISTIC_COUNT; c++) data_size += client->getValue(static_cast<BTDevInfCharacteristic>(c)).size();
+  }
+  if (data_size > UINT32_MAX) return false;
+  
+  std::vector<uint8_t> built(HEADER_SIZE + new_count * RECORD_SIZE + data_size, 0);
+  writeHeader(built.data(), new_count, data_size);
+  uint8_t* entry = built.data() + HEADER_SIZE;
+  uint8_t* data_start = entry + new_count * RECORD_SIZE;
+  uint8_t* data = data_start;
+  bool inserted = address == nullptr;
+  
+  for (size_t i = 0; i <= record_count; i++) {
+    // The new record goes before the first existing one with a greater address
+    if (!inserted && (i == record_count || compareAddress(image_data + HEADER_SIZE + i * RECORD_SIZE, *address) > 0)) {
+      memcpy(entry + RECORD_ADDRESS, address->getVal(), 6);
+      entry[RECORD_ADDRESS_TYPE] = address->getType();
+      writeU32(entry + RECORD_DATA_OFFSET, data - data_start);
+      
+      uint16_t present = 0;
+      for (size_t c = 0; c < BTDEVINF_CHARACTERISTIC_COUNT; c++) {
+        BTDevInfCharacteristic characteristic = static_cast<BTDevInfCharacteristic>(c);
+        const std::vector<uint8_t>& value = client->getValue(characteristic);
+        if (client->hasValue(characteristic)) present |= 1 << c;
+        writeU16(entry + RECORD_LENGTHS + 2 * c, value.size());
+        if (!value.empty()) memcpy(data, value.data(), value.size());
+        data += value.size();
+      }
+      writeU16(entry + RECORD_PRESENT, present);
+      
+      const std::vector<uint8_t>& system_id = client->getValue(BTDevInfCharacteristic::SYSTEM_ID);
+      if (system_id.size() == 8) memcpy(entry + RECORD_SYSTEM_ID, system_id.data(), 8);
+      const std::vector<uint8_t>& pnp_id = client->getValue(BTDevInfCharacteristic::PNP_ID);
+      if (pnp_id.size() == 7) memcpy(entry + RECORD_PNP_ID, pnp_id.data(), 7);
+      
+      entry += RECORD_SIZE;
+      inserted = true;
+    }
+    if (i == record_count) break;
+    if (i == skip_position) continue;
+    
+    BTDevInfCacheRecord record;
+    decodeRecord(i, record);
+    memcpy(entry, image_data + HEADER_SIZE + i * RECORD_SIZE, RECORD_SIZE);
+    writeU32(entry + RECORD_DATA_OFFSET, data - data_start);
+    for (size_t c = 0; c < BTDEVINF_CHARACTERISTIC_COUNT; c++) {
+      if (record.lengths[c] > 0) memcpy(data, record.values[c], record.lengths[c]);
+      data += record.lengths[c];
+    }
+    entry += RECORD_SIZE;
+  }
+  
+  releaseMapping();
+  image.swap(built);
+  image_data = image.data();
+  image_size = image.size();
+  return true;
+}
+
+/**
+ * @brief Check that an image is a well-formed cache of this format version
+ */
+bool BTDevInfCache::validate(const uint8_t* image, size_t length) {
+  if (image == nullptr || length < HEADER_SIZE) return false;
+  if (memcmp(image, MAGIC, sizeof(MAGIC)) != 0) return false;
+  if (readU16(image + 4) != FORMAT_VERSION || readU16(image + 6) != RECORD_SIZE) return false;
+  
+  uint64_t record_count = readU32(image + 8);
+  uint64_t data_size = readU32(image + 12);
+  if (HEADER_SIZE + record_count * RECORD_SIZE + data_size != length) return false;
+  
+  for (uint64_t i = 0; i < record_count; i++) {
+    const uint8_t* entry = image + HEADER_SIZE + i * RECORD_SIZE;
+    uint64_t end = readU32(entry + RECORD_DATA_OFFSET);
+    for (size_t c = 0; c < BTDEVINF_CHARACTERISTIC_COUNT; c++) end += readU16(entry + RECORD_LENGTHS + 2 * c);
+    if (end > data_size) return false;
+    if (readU16(entry + RECORD_PRESENT) >> BTDEVINF_CHARACTERISTIC_COUNT) return false;
+    
+    // Records must be strictly sorted for the binary search
+    if (i > 0) {
+      const uint8_t* previous = entry - RECORD_SIZE;
+      NimBLEAddress address(entry + RECORD_ADDRESS, entry[RECORD_ADDRESS_TYPE]);
+      if (compareAddress(previous, address) >= 0) return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Replace the cache with a copy of an image, for example one kept in NVS
+ * @return false if the image is not a valid cache, in which case the cache is left unchanged
+ */
+bool BTDevInfCache::load(const uint8_t* image, size_t length) {
+  if (!validate(image, length)) return false;
+  
+  releaseMapping();
+  this->image.assign(image, image + length);
+  image_data = this->image.data();
+  image_size = this->image.size();
+  return true;
+}
+
+/**
+ * @brief Replace the cache with the contents of a file written by saveFile()
+ * @return false if the file cannot be read or is not a valid cache, in which case the cache is left unchanged
+ * @note With BTDEVINF_CACHE_MMAP the file is mapped read-only and searched in place until the cache is next modified.
+ */
+bool BTDevInfCache::loadFile(const char* path) {
+#if BTDEVINF_CACHE_MMAP
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+  
+  size_t length = file_stat.st_size;
+  void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) return false;
+  
+  if (!validate(static_cast<const uint8_t*>(mapped), length)) {
+    munmap(mapped, length);
+    return false;
+  }
+  
+  releaseMapping();
+  image.clear();
+  image.shrink_to_fit();
+  mapping = mapped;
+  mapping_size = length;
+  image_data = static_cast<const uint8_t*>(mapped);
+  image_size = length;
+  return true;
+#else
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) return false;
+  
+  std::vector<uint8_t> contents;
+  uint8_t buffer[256];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.insert(contents.end(), buffer, buffer + length);
+  }
+  fclose(file);
+  
+  return load(contents.data(), contents.size());
+#endif
+}
+
+/**
+ * @brief Write the cache image to a file
+ * @note Writes a temporary file next to it and renames it over the old one, so an interrupted save leaves the previous cache intact.
+ */
+bool BTDevInfCache::saveFile(const char* path) const {
+  std::string temporary_path = std::string(path) + ".tmp";
+  FILE* file = fopen(temporary_path.c_str(), "wb");
+  if (file == nullptr) return false;
+  
+  bool written = fwrite(image_data, 1, image_size, file) == image_size;
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temporary_path.c_str(), path) != 0) {
+    remove(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void BTDevInfCache::releaseMapping() {
+#if BTDEVINF_CACHE_MMAP
+  if (mapping != nullptr) munmap(mapping, mapping_size);
+#endif
+  mapping = nullptr;
+  mapping_size = 0;
+}
\ No newline at end of file
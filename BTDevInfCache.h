@@ -0,0 +1,84 @@
+#ifndef BTDEVINFCACHE_H
+#define BTDEVINFCACHE_H
+
+#include "BTDevInfClient.h"
+
+#include <vector>
+
+/**
+ * @brief Map cache files with mmap() instead of reading them into memory; needs a POSIX host
+ */
+#ifndef BTDEVINF_CACHE_MMAP
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(ESP_PLATFORM)
+#define BTDEVINF_CACHE_MMAP 1
+#else
+#define BTDEVINF_CACHE_MMAP 0
+#endif
+#endif
+
+/**
+ * @brief One cached Device Information record
+ * @note The pointers point into the cache image and stay valid until the cache is modified, loaded or destroyed.
+ */
+struct BTDevInfCacheRecord {
+  const uint8_t* address;   // 6 octets, least significant first
+  uint8_t address_type;
+  const uint8_t* system_id; // 8 octets, all zero if the peer has no System ID
+  const uint8_t* pnp_id;    // 7 octets, all zero if the peer has no PnP ID
+  uint16_t present;         // Bit n set if the value of BTDevInfCharacteristic n was read
+  const uint8_t* values[BTDEVINF_CHARACTERISTIC_COUNT];
+  uint16_t lengths[BTDEVINF_CHARACTERISTIC_COUNT];
+};
+
+/**
+ * @brief Client-side cache of peers' Device Information, keyed by peer address, System ID and PnP ID
+ * @note The cache is kept as a single image in its file format, so a file can be mapped and searched in place:
+ *       a 16-octet header ("BDIC", u16 version, u16 record size, u32 record count, u32 data size),
+ *       fixed-size records sorted by address, then the values of all records. All integers are little endian.
+ * @note Lookups are a binary search over the records and do not allocate. Storing or removing a record rebuilds the image.
+ */
+class BTDevInfCache {
+  public:
+    static const uint16_t FORMAT_VERSION = 1;
+    static const uint16_t HEADER_SIZE = 16;
+    static const uint16_t RECORD_SIZE = 52;
+    
+    BTDevInfCache();
+    ~BTDevInfCache();
+    BTDevInfCache(const BTDevInfCache&) = delete;
+    BTDevInfCache& operator=(const BTDevInfCache&) = delete;
+    
+    bool find(const NimBLEAddress& address, BTDevInfCacheRecord& record) const;
+    bool find(const NimBLEAddress& address, const uint8_t* system_id, const uint8_t* pnp_id, BTDevInfCacheRecord& record) const;
+    bool findByIdentity(const uint8_t* system_id, const uint8_t* pnp_id, BTDevInfCacheRecord& record) const;
+    
+    bool store(const NimBLEAddress& address, const BTDevInfClient& client);
+    bool invalidate(const NimBLEAddress& address);
+    bool invalidateIfFirmwareChanged(const NimBLEAddress& address, const char* firmware_revision, size_t length);
+    void clear();
+    
+    size_t getRecordCount() const;
+    const uint8_t* getImage() const { return image_data; }
+    size_t getImageSize() const { return image_size; }
+    
+    bool load(const uint8_t* image, size_t length);
+    bool loadFile(const char* path);
+    bool saveFile(const char* path) const;
+  
+  private:
+    static bool validate(const uint8_t* image, size_t length);
+    static int compareAddress(const uint8_t* record, const NimBLEAddress& address);
+    
+    void decodeRecord(size_t position, BTDevInfCacheRecord& record) const;
+    int findPosition(const NimBLEAddress& address, bool& found) const;
+    bool rebuild(size_t skip_position, const NimBLEAddress* address, const BTDevInfClient* client);
+    void releaseMapping();
+    
+    std::vector<uint8_t> image;  // Owned image, empty while a file is mapped
+    const uint8_t* image_data;   // The image in use, owned or mapped
+    size_t image_size;
+    void* mapping;
+    size_t mapping_size;
+};
+
+#endif // BTDEVINFCACHE_H
\ No newline at end of file
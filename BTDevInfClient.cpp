@@ -0,0 +1,404 @@
+#include "BTDevInfClient.h"
+#include "BTDevInfCache.h"
+
+/**
+ * @brief Construct a BTDevInfClient instance
+ * @param client A pointer to a connected client whose peer exposes a Device Information Service
+ */
+BTDevInfClient::BTDevInfClient(NimBLEClient* client) : client(client) {
+  read_multiple_variable = BTDEVINF_CLIENT_READ_MULTIPLE_VARIABLE;
+  task_data = nullptr;
+  queue_length = 0;
+  queue_position = 0;
+  reading_long = false;
+  att_requests = 0;
+  used_read_multiple_variable = false;
+  
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    handles[i] = 0;
+    statuses[i] = BLE_HS_ENOENT;
+  }
+}
+
+/**
+ * @brief Discover the peer's Device Information Service and read all its known characteristics
+ * @return A report of the read, see BTDevInfClient::ReadReport
+ * @note Blocks the calling task once for the values, in addition to the waits of service and characteristic discovery. Must not be called from the NimBLE host task.
+ * @note Characteristics that fail, for example with insufficient authentication on an unbonded link, are left out and their error is available from getStatus(). The rest are still read.
+ */
+BTDevInfClient::ReadReport BTDevInfClient::read() {
+  ReadReport report = {false, 0, 0, false, false};
+  
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    handles[i] = 0;
+    statuses[i] = BLE_HS_ENOENT;
+    values[i].clear();
+  }
+  
+  if (client == nullptr || !client->isConnected()) return report;
+  
+  NimBLERemoteService* service = client->getService(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
+  if (service == nullptr) return report;
+  
+  // Match discovered characteristics against the table by their 16-bit UUID
+  queue_length = 0;
+  for (NimBLERemoteCharacteristic* characteristic : service->getCharacteristics(true)) {
+    const NimBLEUUID& uuid = characteristic->getUUID();
+    if (uuid.bitSize() != 16 || !characteristic->canRead()) continue;
+    
+    uint16_t uuid16 = uuid.getValue()[0] | (uuid.getValue()[1] << 8);
+    for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+      if (BTDEVINF_CHARACTERISTIC_SPECS[i].uuid == uuid16 && handles[i] == 0) {
+        handles[i] = characteristic->getHandle();
+        queue[queue_length++] = i;
+        break;
+      }
+    }
+  }
+  
+  report.success = true;
+  if (queue_length == 0) return report;
+  
+  NimBLETaskData read_task_data(this);
+  task_data = &read_task_data;
+  queue_position = 0;
+  reading_long = false;
+  att_requests = 0;
+  used_read_multiple_variable = false;
+  
+  // Everything from here on runs in the completion callbacks
+  readNext();
+  NimBLEUtils::taskWait(read_task_data, BLE_NPL_TIME_FOREVER);
+  task_data = nullptr;
+  
+  if (read_task_data.m_flags != 0) report.success = false;
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    if (statuses[i] == 0) report.characteristic_count++;
+  }
+  report.att_requests = att_requests;
+  report.used_read_multiple_variable = used_read_multiple_variable;
+  return report;
+}
+
+/**
+ * @brief Take the values from a cache if it holds a record for the peer address, otherwise read them and store them in the cache
+ * @param cache The cache to look up and update
+ * @note Use BTDevInfCache::invalidateIfFirmwareChanged() or BTDevInfCache::invalidate() beforehand to force a fresh read.
+ * @note The values are only stored if every characteristic the peer has was read. One that failed, for example with insufficient authentication before pairing, leaves the cache as it is, so the next read after pairing reads all of them again instead of taking the gap from the cache.
+ */
+BTDevInfClient::ReadReport BTDevInfClient::read(BTDevInfCache& cache) {
+  if (client == nullptr) return {false, 0, 0, false, false};
+  
+  NimBLEAddress address = client->getPeerAddress();
+  BTDevInfCacheRecord record;
+  if (cache.find(address, record) && load(record)) {
+    ReadReport report = {true, 0, 0, false, true};
+    for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+      if (statuses[i] == 0) report.characteristic_count++;
+    }
+    return report;
+  }
+  
+  ReadReport report = read();
+  bool complete = report.success;
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    if (statuses[i] != 0 && statuses[i] != BLE_HS_ENOENT) complete = false;
+  }
+  if (complete) cache.store(address, *this);
+  return report;
+}
+
+/**
+ * @brief Take the values from a cache record instead of reading them from the peer
+ * @return true if the record was loaded
+ * @note A characteristic missing from the record is one the peer does not have, and reports BLE_HS_ENOENT from getStatus(); BTDevInfClient::read(BTDevInfCache&) does not store records with values that failed to read.
+ */
+bool BTDevInfClient::load(const BTDevInfCacheRecord& record) {
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    handles[i] = 0;
+    if (record.present & (1 << i)) {
+      statuses[i] = 0;
+      values[i].assign(record.values[i], record.values[i] + record.lengths[i]);
+    } else {
+      statuses[i] = BLE_HS_ENOENT;
+      values[i].clear();
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Issue the request for the characteristics left in the queue, or release the waiting task when there are none
+ */
+void BTDevInfClient::readNext() {
+  uint8_t remaining = queue_length - queue_position;
+  if (remaining == 0) {
+    NimBLEUtils::taskRelease(*task_data, 0);
+    return;
+  }
+  
+  int rc;
+#if BTDEVINF_CLIENT_READ_MULTIPLE_VARIABLE
+  // A Read Multiple Variable Length request needs at least two handles
+  if (read_multiple_variable && remaining >= 2) {
+    uint16_t request_handles[BTDEVINF_CHARACTERISTIC_COUNT];
+    for (uint8_t i = 0; i < remaining; i++) {
+      request_handles[i] = handles[queue[queue_position + i]];
+    }
+    rc = ble_gattc_read_mult_var(client->getConnHandle(), request_handles, remaining, onReadMultipleVariable, this);
+    if (rc == 0) return;
+    read_multiple_variable = false;
+  }
+#endif
+  
+  rc = ble_gattc_read(client->getConnHandle(), handles[queue[queue_position]], onRead, this);
+  if (rc != 0) NimBLEUtils::taskRelease(*task_data, rc);
+}
+
+/**
+ * @brief Record the outcome of the characteristic at the head of the queue and move on to the next
+ */
+void BTDevInfClient::finishCurrent(int status) {
+  uint8_t index = queue[queue_position];
+  statuses[index] = status;
+  if (status != 0) values[index].clear();
+  
+  reading_long = false;
+  queue_position++;
+  readNext();
+}
+
+int BTDevInfClient::onReadMultipleVariable(uint16_t /*conn_handle*/, const struct ble_gatt_error* error, struct ble_gatt_attr* attrs, uint8_t num_attrs, void* arg) {
+  BTDevInfClient* reader = static_cast<BTDevInfClient*>(arg);
+  reader->att_requests++;
+  
+  if (error->status == BLE_HS_ATT_ERR(BLE_ATT_ERR_REQ_NOT_SUPPORTED) || (error->status == 0 && num_attrs == 0)) {
+    reader->read_multiple_variable = false;
+    reader->readNext();
+    return 0;
+  }
+  
+  if (error->status != 0) {
+    // The whole request fails on the first unreadable handle; drop it and request the rest again
+    int index = reader->findIndex(error->att_handle);
+    if (index < 0) {
+      NimBLEUtils::taskRelease(*reader->task_data, error->status);
+      return 0;
+    }
+    
+    for (uint8_t i = reader->queue_position; i < reader->queue_length; i++) {
+      if (reader->queue[i] == index) {
+        reader->queue[i] = reader->queue[reader->queue_position];
+        reader->queue[reader->queue_position] = index;
+        break;
+      }
+    }
+    reader->finishCurrent(error->status);
+    return 0;
+  }
+  
+  reader->used_read_multiple_variable = true;
+  
+  // Each value is preceded by a 2-octet length; a response that fills the MTU may have cut the last value short
+  size_t response_length = 0;
+  for (uint8_t i = 0; i < num_attrs; i++) {
+    uint8_t index = reader->queue[reader->queue_position + i];
+    uint16_t length = OS_MBUF_PKTLEN(attrs[i].om);
+    reader->values[index].resize(length);
+    os_mbuf_copydata(attrs[i].om, 0, length, reader->values[index].data());
+    reader->statuses[index] = 0;
+    response_length += 2 + length;
+  }
+  reader->queue_position += num_attrs;
+  
+  if (response_length >= static_cast<size_t>(reader->client->getMTU() - 1)) {
+    reader->queue_position--;
+    uint8_t index = reader->queue[reader->queue_position];
+    reader->reading_long = true;
+    int rc = ble_gattc_read_long(reader->client->getConnHandle(), reader->handles[index], reader->values[index].size(), onRead, reader);
+    if (rc != 0) reader->finishCurrent(rc);
+    return 0;
+  }
+  
+  reader->readNext();
+  return 0;
+}
+
+int BTDevInfClient::onRead(uint16_t /*conn_handle*/, const struct ble_gatt_error* error, struct ble_gatt_attr* attr, void* arg) {
+  BTDevInfClient* reader = static_cast<BTDevInfClient*>(arg);
+  uint8_t index = reader->queue[reader->queue_position];
+  
+  if (error->status == BLE_HS_EDONE) {
+    reader->finishCurrent(0);
+    return 0;
+  }
+  
+  reader->att_requests++;
+  if (error->status != 0 || attr == nullptr) {
+    reader->finishCurrent(error->status != 0 ? error->status : BLE_HS_EINVAL);
+    return 0;
+  }
+  
+  std::vector<uint8_t>& value = reader->values[index];
+  uint16_t length = OS_MBUF_PKTLEN(attr->om);
+  value.resize(attr->offset + length);
+  os_mbuf_copydata(attr->om, 0, length, value.data() + attr->offset);
+  
+  // Read Blob requests continue until BLE_HS_EDONE
+  if (reader->reading_long) return 0;
+  
+  // A full response means the value may continue past MTU-1 octets
+  if (length >= reader->client->getMTU() - 1) {
+    reader->reading_long = true;
+    int rc = ble_gattc_read_long(reader->client->getConnHandle(), attr->handle, value.size(), onRead, reader);
+    if (rc != 0) reader->finishCurrent(rc);
+    return 0;
+  }
+  
+  reader->finishCurrent(0);
+  return 0;
+}
+
+int BTDevInfClient::findIndex(uint16_t handle) const {
+  for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+    if (handles[i] != 0 && handles[i] == handle) return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Check whether a characteristic was read successfully
+ */
+bool BTDevInfClient::hasValue(BTDevInfCharacteristic characteristic) const {
+  return statuses[static_cast<size_t>(characteristic)] == 0;
+}
+
+/**
+ * @brief Get the outcome of reading a characteristic
+ * @return 0 if it was read, BLE_HS_ENOENT if the peer does not have it, otherwise the NimBLE host error, for example BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHEN)
+ */
+int BTDevInfClient::getStatus(BTDevInfCharacteristic characteristic) const {
+  return statuses[static_cast<size_t>(characteristic)];
+}
+
+/**
+ * @brief Get the raw value of a characteristic, empty if it was not read
+ */
+const std::vector<uint8_t>& BTDevInfClient::getValue(BTDevInfCharacteristic characteristic) const {
+  return values[static_cast<size_t>(characteristic)];
+}
+
+std::string BTDevInfClient::getString(BTDevInfCharacteristic characteristic) const {
+  const std::vector<uint8_t>& value = getValue(characteristic);
+  return std::string(value.begin(), value.end());
+}
+
+/**
+ * @brief Get the system ID as read, least significant octet first on the air
+ * @param system_id Receives the 40-bit manufacturer-defined identifier in the low bits and the 24-bit OUI in the high bits
+ * @return true if the value was read and is 8 octets long
+ */
+bool BTDevInfClient::getSystemID(uint64_t& system_id) const {
+  const std::vector<uint8_t>& value = getValue(BTDevInfCharacteristic::SYSTEM_ID);
+  if (value.size() != 8) return false;
+  
+  system_id = 0;
+  for (size_t i = 0; i < 8; i++) {
+    system_id |= static_cast<uint64_t>(value[i]) << (8 * i);
+  }
+  return true;
+}
+
+std::string BTDevInfClient::getModelNumberString() const {
+  return getString(BTDevInfCharacteristic::MODEL_NUMBER_STRING);
+}
+
+std::string BTDevInfClient::getSerialNumberString() const {
+  return getString(BTDevInfCharacteristic::SERIAL_NUMBER_STRING);
+}
+
+std::string BTDevInfClient::getFirmwareRevisionString() const {
+  return getString(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING);
+}
+
+std::string BTDevInfClient::getHardwareRevisionString() const {
+  return getString(BTDevInfCharacteristic::HARDWARE_REVISION_STRING);
+}
+
+std::string BTDevInfClient::getSoftwareRevisionString() const {
+  return getString(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING);
+}
+
+std::string BTDevInfClient::getManufacturerNameString() const {
+  return getString(BTDevInfCharacteristic::MANUFACTURER_NAME_STRING);
+}
+
+const std::vector<uint8_t>& BTDevInfClient::getIEEERegulatoryCertificationDataList() const {
+  return getValue(BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST);
+}
+
+/**
+ * @brief Get the decoded PnP ID
+ * @return true if the value was read and has the 7-octet layout
+ */
+bool BTDevInfClient::getPnPID(BTDevInfPnPID& pnp_id) const {
+  const std::vector<uint8_t>& value = getValue(BTDevInfCharacteristic::PNP_ID);
+  return decodePnPID(value.data(), value.size(), pnp_id);
+}
+
+std::string BTDevInfClient::getUDIForMedicalDevices() const {
+  return getString(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES);
+}
+
+/**
+ * @brief Decode a PnP ID value as written by BTDevInf::setPnPID()
+ * @param data The 7-octet value: vendor ID source, then vendor ID, product ID and product version, each little endian
+ * @return false if the length is not 7
+ */
+bool BTDevInfClient::decodePnPID(const uint8_t* data, size_t length, BTDevInfPnPID& pnp_id) {
+  if (data == nullptr || length != 7) return false;
+  
+  pnp_id.vendor_id_source = data[0];
+  pnp_id.vendor_id = data[1] | (data[2] << 8);
+  pnp_id.product_id = data[3] | (data[4] << 8);
+  pnp_id.product_version = data[5] | (data[6] << 8);
+  return true;
+}
+
+/**
+ * @brief Decode the Device Information a peer advertises, so a scanner can identify it without connecting
+ * @param data Manufacturer data as found in the advertisement or scan response, starting with the company ID
+ * @param length Length of the data in octets
+ * @return false if the data is not in BTDEVINF_ADVERTISING_FORMAT_VERSION format
+ */
+bool BTDevInfClient::decodeManufacturerData(const uint8_t* data, size_t length, BTDevInfAdvertisedInfo& info) {
+  if (data == nullptr || length < 3) return false;
+  
+  uint8_t header = data[2];
+  if ((header >> 5) != BTDEVINF_ADVERTISING_FORMAT_VERSION) return false;
+  
+  info.company_id = data[0] | (data[1] << 8);
+  info.fields = header & (BTDEVINF_ADVERTISE_PNP_ID | BTDEVINF_ADVERTISE_FIRMWARE_REVISION | BTDEVINF_ADVERTISE_MODEL_NUMBER);
+  info.pnp_id = {0, 0, 0, 0};
+  info.firmware_revision.clear();
+  info.firmware_revision_truncated = header & BTDEVINF_ADVERTISING_FIRMWARE_TRUNCATED;
+  info.model_number.clear();
+  info.model_number_truncated = header & BTDEVINF_ADVERTISING_MODEL_TRUNCATED;
+  
+  size_t position = 3;
+  if (info.fields & BTDEVINF_ADVERTISE_PNP_ID) {
+    if (!decodePnPID(data + position, length - position < 7 ? 0 : 7, info.pnp_id)) return false;
+    position += 7;
+  }
+  
+  std::string* strings[] = {&info.firmware_revision, &info.model_number};
+  const uint8_t flags[] = {BTDEVINF_ADVERTISE_FIRMWARE_REVISION, BTDEVINF_ADVERTISE_MODEL_NUMBER};
+  for (size_t i = 0; i < 2; i++) {
+    if (!(info.fields & flags[i])) continue;
+    if (position >= length || data[position] > length - position - 1) return false;
+    strings[i]->assign(reinterpret_cast<const char*>(data + position + 1), data[position]);
+    position += 1 + data[position];
+  }
+  
+  return position == length;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef BTDEVINFCLIENT_H
+#define BTDEVINFCLIENT_H
+
+#include "BTDevInf.h"
+
+#include <string>
+#include <vector>
+
+struct BTDevInfCacheRecord;
+class BTDevInfCache;
+
+/**
+ * @brief Read Multiple Variable Length requests need BLE_GATT_READ_MULT_VAR in the NimBLE configuration; define as 0 to always use queued reads
+ */
+#ifndef BTDEVINF_CLIENT_READ_MULTIPLE_VARIABLE
+#if defined(MYNEWT_VAL_BLE_GATT_READ_MULT_VAR) && MYNEWT_VAL_BLE_GATT_READ_MULT_VAR
+#define BTDEVINF_CLIENT_READ_MULTIPLE_VARIABLE 1
+#else
+#define BTDEVINF_CLIENT_READ_MULTIPLE_VARIABLE 0
+#endif
+#endif
+
+/**
+ * @brief Fields of the PnP ID characteristic
+ */
+struct BTDevInfPnPID {
+  uint8_t vendor_id_source; // 0x01 Bluetooth SIG, 0x02 USB Implementer's Forum
+  uint16_t vendor_id;
+  uint16_t product_id;
+  uint16_t product_version;
+};
+
+/**
+ * @brief Device Information a peer advertises in its manufacturer data, see BTDevInf::setAdvertising()
+ */
+struct BTDevInfAdvertisedInfo {
+  uint16_t company_id;
+  uint8_t fields; // BTDEVINF_ADVERTISE_* flags of the fields present
+  BTDevInfPnPID pnp_id;
+  std::string firmware_revision;
+  bool firmware_revision_truncated;
+  std::string model_number;
+  bool model_number_truncated;
+};
+
+/**
+ * @brief Reads the Device Information Service of a connected peer
+ * @note Fetches every readable characteristic with as few ATT requests as the peer allows: Read Multiple Variable Length requests where supported, otherwise one Read per characteristic issued from the completion of the previous one, so the calling task only waits once.
+ */
+class BTDevInfClient {
+  public:
+    /**
+     * @brief Outcome of BTDevInfClient::read()
+     */
+    struct ReadReport {
+      bool success;                    // The service was found and every readable characteristic was attempted
+      uint8_t characteristic_count;    // Characteristics read successfully
+      uint16_t att_requests;           // ATT requests used for the values, discovery not included
+      bool used_read_multiple_variable; // At least one Read Multiple Variable Length request succeeded
+      bool from_cache;                 // The values came from a BTDevInfCache record, no requests were made
+    };
+    
+    BTDevInfClient(NimBLEClient* client);
+    BTDevInfClient(const BTDevInfClient&) = delete;
+    BTDevInfClient& operator=(const BTDevInfClient&) = delete;
+    
+    ReadReport read();
+    ReadReport read(BTDevInfCache& cache);
+    bool load(const BTDevInfCacheRecord& record);
+    
+    bool hasValue(BTDevInfCharacteristic characteristic) const;
+    int getStatus(BTDevInfCharacteristic characteristic) const;
+    const std::vector<uint8_t>& getValue(BTDevInfCharacteristic characteristic) const;
+    
+    bool getSystemID(uint64_t& system_id) const;
+    std::string getModelNumberString() const;
+    std::string getSerialNumberString() const;
+    std::string getFirmwareRevisionString() const;
+    std::string getHardwareRevisionString() const;
+    std::string getSoftwareRevisionString() const;
+    std::string getManufacturerNameString() const;
+    const std::vector<uint8_t>& getIEEERegulatoryCertificationDataList() const;
+    bool getPnPID(BTDevInfPnPID& pnp_id) const;
+    std::string getUDIForMedicalDevices() const;
+    
+    static bool decodePnPID(const uint8_t* data, size_t length, BTDevInfPnPID& pnp_id);
+    static bool decodeManufacturerData(const uint8_t* data, size_t length, BTDevInfAdvertisedInfo& info);
+  
+  private:
+    static int onReadMultipleVariable(uint16_t conn_handle, const struct ble_gatt_error* error, struct ble_gatt_attr* attrs, uint8_t num_attrs, void* arg);
+    static int onRead(uint16_t conn_handle, const struct ble_gatt_error* error, struct ble_gatt_attr* attr, void* arg);
+    
+    void readNext();
+    void finishCurrent(int status);
+    int findIndex(uint16_t handle) const;
+    std::string getString(BTDevInfCharacteristic characteristic) const;
+    
+    NimBLEClient* client;
+    bool read_multiple_variable;  // Cleared once the peer rejects a Read Multiple Variable Length request
+    
+    uint16_t handles[BTDEVINF_CHARACTERISTIC_COUNT];  // Value handles on the peer, 0 if absent
+    int statuses[BTDEVINF_CHARACTERISTIC_COUNT];
+    std::vector<uint8_t> values[BTDEVINF_CHARACTERISTIC_COUNT];
+    
+    // State of the read in progress, advanced from the NimBLE host task
+    const NimBLETaskData* task_data;
+    uint8_t queue[BTDEVINF_CHARACTERISTIC_COUNT];
+    uint8_t queue_length;
+    uint8_t queue_position;
+    bool reading_long;
+    uint16_t att_requests;
+    bool used_read_multiple_variable;
+};
+
+#endif // BTDEVINFCLIENT_H
\ No newline at end of file
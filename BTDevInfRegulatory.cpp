@@ -0,0 +1,233 @@
+#include "BTDevInfRegulatory.h"
+
+namespace {
+  const size_t LIST_HEADER_LENGTH = 4;
+  const size_t ENTRY_HEADER_LENGTH = 4;
+  const size_t CONTINUA_VERSION_LENGTH = 6; // Versions and the empty device class list
+  
+  // MDER integers are big endian
+  uint16_t readU16(const uint8_t* data) {
+    return (data[0] << 8) | data[1];
+  }
+  
+  void writeU16(uint8_t* data, uint16_t value) {
+    data[0] = (value >> 8) & 0xFF;
+    data[1] = value & 0xFF;
+  }
+  
+  void addU16(uint8_t* data, uint16_t value) {
+    writeU16(data, readU16(data) + value);
+  }
+}
+
+/**
+ * @brief Start an empty list in a buffer
+ * @param buffer Receives the encoded list; must stay valid while the encoder is used
+ * @param capacity Size of buffer in octets, at least 4 for the empty list
+ */
+BTDevInfRegulatoryEncoder::BTDevInfRegulatoryEncoder(uint8_t* buffer, size_t capacity) {
+  this->buffer = buffer;
+  this->capacity = capacity;
+  clear();
+}
+
+/**
+ * @brief Drop every entry and start again from an empty list
+ */
+void BTDevInfRegulatoryEncoder::clear() {
+  length = 0;
+  entry_count = 0;
+  open_entry = NO_ENTRY;
+  failed = buffer == nullptr || capacity < LIST_HEADER_LENGTH;
+  if (failed) return;
+  
+  writeU16(buffer, 0);
+  writeU16(buffer + 2, 0);
+  length = LIST_HEADER_LENGTH;
+}
+
+/**
+ * @brief Add a Continua entry with the implementation guidelines version the device is certified against
+ * @param major_version Major version of the Continua Design Guidelines
+ * @param minor_version Minor version
+ * @return true if it fits
+ * @note Follow with addCertifiedDeviceClass() for each certified device class; they are added to this entry until another entry is added.
+ */
+bool BTDevInfRegulatoryEncoder::addContinuaVersion(uint8_t major_version, uint8_t minor_version) {
+  uint8_t* data = beginEntry(BTDEVINF_REGULATORY_AUTH_BODY_CONTINUA, BTDEVINF_REGULATORY_CONTINUA_VERSION_STRUCT, CONTINUA_VERSION_LENGTH);
+  if (data == nullptr) return false;
+  
+  data[0] = major_version;
+  data[1] = minor_version;
+  writeU16(data + 2, 0); // Device class count
+  writeU16(data + 4, 0); // Device class list length
+  open_entry = data - ENTRY_HEADER_LENGTH - buffer;
+  return true;
+}
+
+/**
+ * @brief Add a certified device class to the Continua version entry added last
+ * @param device_class The certified device class entry, as assigned in the Continua Design Guidelines
+ * @return true if it fits, false also if the last entry added is not a Continua version entry
+ */
+bool BTDevInfRegulatoryEncoder::addCertifiedDeviceClass(uint16_t device_class) {
+  if (failed || open_entry == NO_ENTRY) return false;
+  if (!reserve(2)) return false;
+  
+  writeU16(buffer + length, device_class);
+  length += 2;
+  
+  uint8_t* entry = buffer + open_entry;
+  addU16(entry + 2, 2);                       // Entry length
+  addU16(entry + ENTRY_HEADER_LENGTH + 2, 1); // Device class count
+  addU16(entry + ENTRY_HEADER_LENGTH + 4, 2); // Device class list length
+  writeU16(buffer + 2, length - LIST_HEADER_LENGTH);
+  return true;
+}
+
+/**
+ * @brief Add the Continua regulation bit field
+ * @param regulation_bits BTDEVINF_REGULATION_* bits; BTDEVINF_REGULATION_UNREGULATED_DEVICE for a device that is not regulated, 0 for one that is
+ * @return true if it fits
+ */
+bool BTDevInfRegulatoryEncoder::addRegulationBitField(uint16_t regulation_bits) {
+  uint8_t* data = beginEntry(BTDEVINF_REGULATORY_AUTH_BODY_CONTINUA, BTDEVINF_REGULATORY_CONTINUA_REG_STRUCT, 2);
+  if (data == nullptr) return false;
+  
+  writeU16(data, regulation_bits);
+  return true;
+}
+
+/**
+ * @brief Add an entry of any authorizing body with its data already encoded
+ * @param auth_body The authorizing body, such as BTDEVINF_REGULATORY_AUTH_BODY_IEEE_11073
+ * @param struc_type The structure type of the data, defined by the authorizing body
+ * @param data The encoded data
+ * @param length Length of the data in octets
+ * @return true if it fits
+ */
+bool BTDevInfRegulatoryEncoder::addEntry(uint8_t auth_body, uint8_t struc_type, const uint8_t* data, size_t length) {
+  if (length > UINT16_MAX) {
+    failed = true;
+    return false;
+  }
+  
+  uint8_t* entry_data = beginEntry(auth_body, struc_type, length);
+  if (entry_data == nullptr) return false;
+  
+  if (length > 0) memcpy(entry_data, data, length);
+  return true;
+}
+
+uint8_t* BTDevInfRegulatoryEncoder::beginEntry(uint8_t auth_body, uint8_t struc_type, size_t data_length) {
+  if (failed) return nullptr;
+  if (entry_count == UINT16_MAX) {
+    failed = true;
+    return nullptr;
+  }
+  if (!reserve(ENTRY_HEADER_LENGTH + data_length)) return nullptr;
+  
+  uint8_t* entry = buffer + length;
+  entry[0] = auth_body;
+  entry[1] = struc_type;
+  writeU16(entry + 2, data_length);
+  length += ENTRY_HEADER_LENGTH + data_length;
+  entry_count++;
+  
+  writeU16(buffer, entry_count);
+  writeU16(buffer + 2, length - LIST_HEADER_LENGTH);
+  open_entry = NO_ENTRY;
+  return entry + ENTRY_HEADER_LENGTH;
+}
+
+bool BTDevInfRegulatoryEncoder::reserve(size_t octets) {
+  // The list length is a u16, so the entries can use at most UINT16_MAX octets whatever the capacity
+  if (octets > capacity - length || length - LIST_HEADER_LENGTH + octets > UINT16_MAX) {
+    failed = true;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Check a list and prepare to read its entries
+ * @param data The list, typically the value of a peer's IEEE Regulatory Certification characteristic; must stay valid while the decoder is used
+ * @param length Length of the data in octets
+ * @note The list is valid if its count and length agree with its entries and nothing follows them.
+ */
+BTDevInfRegulatoryDecoder::BTDevInfRegulatoryDecoder(const uint8_t* data, size_t length) {
+  this->data = data;
+  this->length = length;
+  entry_count = 0;
+  valid = false;
+  
+  if (data == nullptr || length < LIST_HEADER_LENGTH) return;
+  if (readU16(data + 2) != length - LIST_HEADER_LENGTH) return;
+  
+  uint16_t count = readU16(data);
+  size_t position = LIST_HEADER_LENGTH;
+  for (uint16_t i = 0; i < count; i++) {
+    if (length - position < ENTRY_HEADER_LENGTH) return;
+    position += ENTRY_HEADER_LENGTH + readU16(data + position + 2);
+    if (position > length) return;
+  }
+  if (position != length) return;
+  
+  entry_count = count;
+  valid = true;
+}
+
+/**
+ * @brief Get one entry of the list
+ * @param index Index of the entry, less than getEntryCount()
+ * @param entry Receives the entry; its data points into the decoded list
+ * @return true if the list is valid and has the entry
+ */
+bool BTDevInfRegulatoryDecoder::getEntry(uint16_t index, BTDevInfRegulatoryEntry& entry) const {
+  if (!valid || index >= entry_count) return false;
+  
+  size_t position = LIST_HEADER_LENGTH;
+  for (uint16_t i = 0; i < index; i++) {
+    position += ENTRY_HEADER_LENGTH + readU16(data + position + 2);
+  }
+  
+  entry.auth_body = data[position];
+  entry.struc_type = data[position + 1];
+  entry.length = readU16(data + position + 2);
+  entry.data = data + position + ENTRY_HEADER_LENGTH;
+  return true;
+}
+
+/**
+ * @brief Read a Continua version entry
+ * @param entry An entry from getEntry()
+ * @param version Receives the guidelines version and the certified device classes
+ * @return true if the entry is a well-formed Continua version entry
+ */
+bool BTDevInfRegulatoryDecoder::decodeContinuaVersion(const BTDevInfRegulatoryEntry& entry, BTDevInfContinuaVersion& version) {
+  if (entry.auth_body != BTDEVINF_REGULATORY_AUTH_BODY_CONTINUA || entry.struc_type != BTDEVINF_REGULATORY_CONTINUA_VERSION_STRUCT) return false;
+  if (entry.length < CONTINUA_VERSION_LENGTH) return false;
+  
+  uint16_t count = readU16(entry.data + 2);
+  uint16_t list_length = readU16(entry.data + 4);
+  if (list_length != 2 * static_cast<size_t>(count) || entry.length != CONTINUA_VERSION_LENGTH + list_length) return false;
+  
+  version.major_version = entry.data[0];
+  version.minor_version = entry.data[1];
+  version.device_class_count = count;
+  version.device_classes = entry.data + CONTINUA_VERSION_LENGTH;
+  return true;
+}
+
+/**
+ * @brief Read a Continua regulation entry
+ * @param entry An entry from getEntry()
+ * @param regulation_bits Receives the BTDEVINF_REGULATION_* bits
+ * @return true if the entry is a well-formed Continua regulation entry
+ */
+bool BTDevInfRegulatoryDecoder::decodeRegulationBitField(const BTDevInfRegulatoryEntry& entry, uint16_t& regulation_bits) {
+  if (entry.auth_body != BTDEVINF_REGULATORY_AUTH_BODY_CONTINUA || entry.struc_type != BTDEVINF_REGULATORY_CONTINUA_REG_STRUCT || entry.length != 2) return false;
+  
+  regulation_bits = readU16(entry.data);
+  return true;
+}
@@ -0,0 +1,115 @@
+#ifndef BTDEVINFREGULATORY_H
+#define BTDEVINFREGULATORY_H
+
+#include "BTDevInf.h"
+
+/**
+ * @brief Authorizing bodies and structure types of IEEE 11073-20601 regulatory certification data
+ */
+inline constexpr uint8_t BTDEVINF_REGULATORY_AUTH_BODY_EMPTY = 0;
+inline constexpr uint8_t BTDEVINF_REGULATORY_AUTH_BODY_IEEE_11073 = 1;
+inline constexpr uint8_t BTDEVINF_REGULATORY_AUTH_BODY_CONTINUA = 2;
+
+inline constexpr uint8_t BTDEVINF_REGULATORY_CONTINUA_VERSION_STRUCT = 1; // Implementation guidelines version and certified device classes
+inline constexpr uint8_t BTDEVINF_REGULATORY_CONTINUA_REG_STRUCT = 2;     // Regulation bit field
+
+/**
+ * @brief Bits of the Continua regulation bit field; bit 0 of the ASN.1 BITS-16 type is the most significant bit
+ */
+inline constexpr uint16_t BTDEVINF_REGULATION_UNREGULATED_DEVICE = 0x8000;
+
+/**
+ * @brief Encodes an IEEE 11073-20601 regulatory certification data list into a caller-provided buffer, without allocating
+ * @note The list is encoded in MDER, big endian: a count and a length (u16 each), then per entry the authorizing body and structure type (u8 each), a length (u16) and the data.
+ *       A Continua version entry holds the major and minor guidelines version (u8 each) and the certified device classes as a counted list of u16; a Continua regulation entry holds the 16-bit regulation bit field.
+ * @note The buffer holds a complete list after every call, so getData() and getLength() can be used at any point. Once something does not fit, every further call fails and getLength() returns 0.
+ */
+class BTDevInfRegulatoryEncoder {
+  public:
+    BTDevInfRegulatoryEncoder(uint8_t* buffer, size_t capacity);
+    BTDevInfRegulatoryEncoder(const BTDevInfRegulatoryEncoder&) = delete;
+    BTDevInfRegulatoryEncoder& operator=(const BTDevInfRegulatoryEncoder&) = delete;
+    
+    bool addContinuaVersion(uint8_t major_version, uint8_t minor_version);
+    bool addCertifiedDeviceClass(uint16_t device_class);
+    bool addRegulationBitField(uint16_t regulation_bits);
+    bool addEntry(uint8_t auth_body, uint8_t struc_type, const uint8_t* data, size_t length);
+    void clear();
+    
+    const uint8_t* getData() const { return buffer; }
+    size_t getLength() const { return failed ? 0 : length; }
+    uint16_t getEntryCount() const { return entry_count; }
+    bool hasFailed() const { return failed; }
+  
+  private:
+    static const size_t NO_ENTRY = SIZE_MAX;
+    
+    uint8_t* beginEntry(uint8_t auth_body, uint8_t struc_type, size_t data_length);
+    bool reserve(size_t octets);
+    
+    uint8_t* buffer;
+    size_t capacity;
+    size_t length;
+    uint16_t entry_count;
+    size_t open_entry; // Offset of the Continua version entry that addCertifiedDeviceClass() appends to
+    bool failed;
+};
+
+/**
+ * @brief A BTDevInfRegulatoryEncoder with its own fixed-capacity buffer
+ * @tparam Capacity Buffer size in octets; the characteristic holds at most BLE_ATT_ATTR_MAX_LEN
+ */
+template <size_t Capacity = BLE_ATT_ATTR_MAX_LEN>
+class BTDevInfRegulatoryList : public BTDevInfRegulatoryEncoder {
+  public:
+    BTDevInfRegulatoryList() : BTDevInfRegulatoryEncoder(storage, Capacity) {}
+  
+  private:
+    uint8_t storage[Capacity];
+};
+
+/**
+ * @brief One entry of a regulatory certification data list, pointing into the decoded data
+ */
+struct BTDevInfRegulatoryEntry {
+  uint8_t auth_body;
+  uint8_t struc_type;
+  const uint8_t* data;
+  uint16_t length;
+};
+
+/**
+ * @brief A Continua version entry, see BTDevInfRegulatoryDecoder::decodeContinuaVersion()
+ */
+struct BTDevInfContinuaVersion {
+  uint8_t major_version;
+  uint8_t minor_version;
+  uint16_t device_class_count;
+  const uint8_t* device_classes; // device_class_count big-endian u16 values
+  
+  uint16_t getCertifiedDeviceClass(uint16_t index) const { return (device_classes[2 * index] << 8) | device_classes[2 * index + 1]; }
+};
+
+/**
+ * @brief Reads an IEEE 11073-20601 regulatory certification data list in place, without allocating
+ * @note The whole list is checked on construction; entries are only available if isValid().
+ */
+class BTDevInfRegulatoryDecoder {
+  public:
+    BTDevInfRegulatoryDecoder(const uint8_t* data, size_t length);
+    
+    bool isValid() const { return valid; }
+    uint16_t getEntryCount() const { return valid ? entry_count : 0; }
+    bool getEntry(uint16_t index, BTDevInfRegulatoryEntry& entry) const;
+    
+    static bool decodeContinuaVersion(const BTDevInfRegulatoryEntry& entry, BTDevInfContinuaVersion& version);
+    static bool decodeRegulationBitField(const BTDevInfRegulatoryEntry& entry, uint16_t& regulation_bits);
+  
+  private:
+    const uint8_t* data;
+    size_t length;
+    uint16_t entry_count;
+    bool valid;
+};
+
+#endif // BTDEVINFREGULATORY_H
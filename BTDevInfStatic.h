@@ -0,0 +1,193 @@
+#ifndef BTDEVINFSTATIC_H
+#define BTDEVINFSTATIC_H
+
+#include "BTDevInf.h"
+
+/**
+ * @brief Device Information Service with its characteristics fixed at compile time
+ * @tparam Fields The characteristics the service can hold, in any order, each at most once
+ * @note Only the setters, characteristic pointers, UUIDs and descriptor strings of the listed characteristics end up in the binary; calling a setter for a characteristic that is not listed fails to compile.
+ * @note An alternative to BTDevInf for fixed profiles, sharing only btdevinfCreateDescriptors() with it. It does not offer static values, value providers, instrumentation, advertising, concurrent updates or snapshots; use BTDevInf when those or a runtime choice of characteristics are needed.
+ */
+template <BTDevInfCharacteristic... Fields>
+class BTDevInfStatic {
+  public:
+    static constexpr size_t FIELD_COUNT = sizeof...(Fields);
+    
+    static_assert(FIELD_COUNT > 0, "BTDevInfStatic needs at least one characteristic");
+    
+    /**
+     * @brief Whether the characteristic is one of Fields
+     */
+    template <BTDevInfCharacteristic Characteristic>
+    static constexpr bool has() { return indexOf<Characteristic>() < FIELD_COUNT; }
+    
+    BTDevInfStatic(NimBLEServer* server, BTDevInfDescriptorPolicy descriptor_policy = BTDevInfDescriptorPolicy::FULL);
+    BTDevInfStatic(const BTDevInfStatic&) = delete;
+    BTDevInfStatic& operator=(const BTDevInfStatic&) = delete;
+    
+    bool startService();
+    uint16_t getAttributeCount() const;
+    
+    template <BTDevInfCharacteristic Characteristic>
+    bool setValue(const uint8_t* data, size_t length);
+    
+    bool setSystemID(const uint8_t* system_id, size_t length) { return setValue<BTDevInfCharacteristic::SYSTEM_ID>(system_id, length); }
+    bool setModelNumberString(std::string_view model_number_string) { return setString<BTDevInfCharacteristic::MODEL_NUMBER_STRING>(model_number_string); }
+    bool setSerialNumberString(std::string_view serial_number_string) { return setString<BTDevInfCharacteristic::SERIAL_NUMBER_STRING>(serial_number_string); }
+    bool setFirmwareRevisionString(std::string_view firmware_revision_string) { return setString<BTDevInfCharacteristic::FIRMWARE_REVISION_STRING>(firmware_revision_string); }
+    bool setHardwareRevisionString(std::string_view hardware_revision_string) { return setString<BTDevInfCharacteristic::HARDWARE_REVISION_STRING>(hardware_revision_string); }
+    bool setSoftwareRevisionString(std::string_view software_revision_string) { return setString<BTDevInfCharacteristic::SOFTWARE_REVISION_STRING>(software_revision_string); }
+    bool setManufacturerNameString(std::string_view manufacturer_name_string) { return setString<BTDevInfCharacteristic::MANUFACTURER_NAME_STRING>(manufacturer_name_string); }
+    bool setIEEERegulatoryCertificationDataList(const uint8_t* data, size_t length) { return setValue<BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST>(data, length); }
+    bool setPnPID(uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version);
+    bool setUDIForMedicalDevices(const uint8_t* udi, size_t length) { return setValue<BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES>(udi, length); }
+    
+    NimBLEService* getService() { return device_info_service; }
+    
+    template <BTDevInfCharacteristic Characteristic>
+    NimBLECharacteristic* getCharacteristic() {
+      static_assert(has<Characteristic>(), "The characteristic is not one of this BTDevInfStatic's Fields");
+      return characteristics[indexOf<Characteristic>()];
+    }
+  
+  private:
+    static constexpr BTDevInfCharacteristic FIELDS[] = {Fields...};
+    
+    // Copied out of BTDEVINF_CHARACTERISTIC_SPECS at compile time, so only the rows of Fields are emitted
+    template <BTDevInfCharacteristic Characteristic>
+    static constexpr BTDevInfCharacteristicSpec SPEC = BTDEVINF_CHARACTERISTIC_SPECS[static_cast<size_t>(Characteristic)];
+    
+    template <BTDevInfCharacteristic Characteristic>
+    static constexpr size_t indexOf() {
+      for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (FIELDS[i] == Characteristic) return i;
+      }
+      return FIELD_COUNT;
+    }
+    
+    static constexpr bool fieldsAreUnique() {
+      for (size_t i = 0; i < FIELD_COUNT; i++) {
+        for (size_t j = i + 1; j < FIELD_COUNT; j++) {
+          if (FIELDS[i] == FIELDS[j]) return false;
+        }
+      }
+      return true;
+    }
+    
+    template <BTDevInfCharacteristic Characteristic>
+    NimBLECharacteristic* createCharacteristic();
+    
+    template <BTDevInfCharacteristic Characteristic>
+    bool setString(std::string_view value) { return setValue<Characteristic>(reinterpret_cast<const uint8_t*>(value.data()), value.size()); }
+    
+    NimBLEService* device_info_service;
+    bool service_created; // The service was created by this instance, so it holds no characteristics from elsewhere
+    BTDevInfDescriptorPolicy descriptor_policy;
+    uint8_t descriptor_count; // Descriptors added to the characteristics created so far
+    NimBLECharacteristic* characteristics[FIELD_COUNT]; // Indexed like Fields
+};
+
+/**
+ * @brief Construct a BTDevInfStatic instance
+ * @param server A pointer to the server instance this Device Information Service will use
+ * @param descriptor_policy Which descriptors the characteristics get, as with BTDevInf::setDescriptorPolicy()
+ */
+template <BTDevInfCharacteristic... Fields>
+BTDevInfStatic<Fields...>::BTDevInfStatic(NimBLEServer* server, BTDevInfDescriptorPolicy descriptor_policy) {
+  static_assert(fieldsAreUnique(), "BTDevInfStatic lists a characteristic more than once");
+  
+  device_info_service = nullptr;
+  service_created = false;
+  this->descriptor_policy = descriptor_policy;
+  descriptor_count = 0;
+  for (NimBLECharacteristic*& characteristic : characteristics) {
+    characteristic = nullptr;
+  }
+  
+  if (server == nullptr) return;
+  
+  device_info_service = server->getServiceByUUID(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
+  if (device_info_service == nullptr) {
+    device_info_service = server->createService(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
+    service_created = true;
+  }
+}
+
+/**
+ * @brief Start the Device Information service
+ * @return true if the service was started successfully, false otherwise
+ */
+template <BTDevInfCharacteristic... Fields>
+bool BTDevInfStatic<Fields...>::startService() {
+  if (device_info_service) {
+    return device_info_service->start();
+  }
+  return false;
+}
+
+/**
+ * @brief Number of attribute handles the characteristics managed by this instance use, including the service declaration
+ */
+template <BTDevInfCharacteristic... Fields>
+uint16_t BTDevInfStatic<Fields...>::getAttributeCount() const {
+  if (device_info_service == nullptr) return 0;
+  
+  uint16_t count = 1 + descriptor_count;
+  for (NimBLECharacteristic* characteristic : characteristics) {
+    if (characteristic != nullptr) count += 2;
+  }
+  return count;
+}
+
+template <BTDevInfCharacteristic... Fields>
+template <BTDevInfCharacteristic Characteristic>
+NimBLECharacteristic* BTDevInfStatic<Fields...>::createCharacteristic() {
+  NimBLECharacteristic*& characteristic = characteristics[indexOf<Characteristic>()];
+  if (device_info_service == nullptr || characteristic != nullptr) return characteristic;
+  
+  constexpr const BTDevInfCharacteristicSpec& spec = SPEC<Characteristic>;
+  
+  // A service this instance created can only hold characteristics it created itself
+  if (!service_created) {
+    characteristic = device_info_service->getCharacteristic(NimBLEUUID(spec.uuid));
+    if (characteristic != nullptr) return characteristic;
+  }
+  characteristic = device_info_service->createCharacteristic(NimBLEUUID(spec.uuid), spec.properties, BLE_ATT_ATTR_MAX_LEN);
+  descriptor_count += btdevinfCreateDescriptors(characteristic, spec, descriptor_policy);
+  
+  return characteristic;
+}
+
+/**
+ * @brief Set the value of one of the Fields, creating its characteristic on first use
+ * @tparam Characteristic The characteristic to set; must be one of Fields
+ * @param data The value
+ * @param length Length of the data in octets
+ * @return true if successful, false if service doesn't exist or the value is longer than BLE_ATT_ATTR_MAX_LEN
+ */
+template <BTDevInfCharacteristic... Fields>
+template <BTDevInfCharacteristic Characteristic>
+bool BTDevInfStatic<Fields...>::setValue(const uint8_t* data, size_t length) {
+  static_assert(has<Characteristic>(), "The characteristic is not one of this BTDevInfStatic's Fields");
+  if (device_info_service == nullptr || length > BLE_ATT_ATTR_MAX_LEN) return false;
+  
+  createCharacteristic<Characteristic>()->setValue(data, length);
+  return true;
+}
+
+/**
+ * @brief Set PnP ID, see BTDevInf::setPnPID()
+ */
+template <BTDevInfCharacteristic... Fields>
+bool BTDevInfStatic<Fields...>::setPnPID(uint8_t vendor_id_source, uint16_t vendor_id, uint16_t product_id, uint16_t product_version) {
+  const uint8_t pnp[7] = {
+    vendor_id_source,
+    static_cast<uint8_t>(vendor_id & 0xFF), static_cast<uint8_t>((vendor_id >> 8) & 0xFF),
+    static_cast<uint8_t>(product_id & 0xFF), static_cast<uint8_t>((product_id >> 8) & 0xFF),
+    static_cast<uint8_t>(product_version & 0xFF), static_cast<uint8_t>((product_version >> 8) & 0xFF)
+  };
+  return setValue<BTDevInfCharacteristic::PNP_ID>(pnp, sizeof(pnp));
+}
+
+#endif // BTDEVINFSTATIC_H
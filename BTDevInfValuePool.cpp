@@ -0,0 +1,58 @@
+#include "BTDevInfValuePool.h"
+
+namespace {
+  std::string_view key(const uint8_t* data, size_t length) {
+    return std::string_view(reinterpret_cast<const char*>(data), length);
+  }
+}
+
+BTDevInfValuePool::BTDevInfValuePool() {
+  value_bytes = 0;
+}
+
+/**
+ * @brief Free every value; the BTDevInf instances that used the pool must already be destroyed
+ */
+BTDevInfValuePool::~BTDevInfValuePool() {
+  for (const auto& entry : values) {
+    delete[] entry.second->data;
+    delete entry.second;
+  }
+}
+
+/**
+ * @brief Number of characteristics served from a value
+ * @return 0 if the pool does not hold the value
+ */
+uint32_t BTDevInfValuePool::getReferenceCount(const uint8_t* data, size_t length) const {
+  auto entry = values.find(key(data, length));
+  return entry == values.end() ? 0 : entry->second->references;
+}
+
+BTDevInfPooledValue* BTDevInfValuePool::acquire(const uint8_t* data, size_t length) {
+  auto entry = values.find(key(data, length));
+  if (entry != values.end()) {
+    entry->second->references++;
+    return entry->second;
+  }
+  
+  BTDevInfPooledValue* value = new BTDevInfPooledValue();
+  value->pool = this;
+  value->data = new uint8_t[length > 0 ? length : 1];
+  if (length > 0) memcpy(value->data, data, length);
+  value->length = length;
+  value->references = 1;
+  values.emplace(key(value->data, length), value);
+  value_bytes += length;
+  return value;
+}
+
+void BTDevInfValuePool::release(BTDevInfPooledValue* value) {
+  if (--value->references > 0) return;
+  
+  BTDevInfValuePool* pool = value->pool;
+  pool->values.erase(key(value->data, value->length));
+  pool->value_bytes -= value->length;
+  delete[] value->data;
+  delete value;
+}
@@ -0,0 +1,46 @@
+#ifndef BTDEVINFVALUEPOOL_H
+#define BTDEVINFVALUEPOOL_H
+
+#include "BTDevInf.h"
+
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief One interned value of a BTDevInfValuePool, shared by every characteristic set to it
+ */
+struct BTDevInfPooledValue {
+  BTDevInfValuePool* pool;
+  uint8_t* data;
+  uint16_t length;
+  uint32_t references; // Characteristics currently served from this value
+};
+
+/**
+ * @brief Interned, reference-counted characteristic values that several BTDevInf instances share, see BTDevInf::setPooledValue()
+ * @note Each distinct value is stored once, however many characteristics use it, and freed when the last of them moves to another value or its BTDevInf is destroyed.
+ *       A characteristic still takes its own copy at its first read, as with static values, so the savings last only until then.
+ * @note Not thread-safe: use a pool from one task, or guard it, as with the setters of the instances that share it. The pool must outlive those instances.
+ */
+class BTDevInfValuePool {
+  public:
+    BTDevInfValuePool();
+    ~BTDevInfValuePool();
+    BTDevInfValuePool(const BTDevInfValuePool&) = delete;
+    BTDevInfValuePool& operator=(const BTDevInfValuePool&) = delete;
+    
+    size_t getValueCount() const { return values.size(); }
+    size_t getValueBytes() const { return value_bytes; }
+    uint32_t getReferenceCount(const uint8_t* data, size_t length) const;
+  
+  private:
+    friend class BTDevInf;
+    
+    BTDevInfPooledValue* acquire(const uint8_t* data, size_t length);
+    static void release(BTDevInfPooledValue* value);
+    
+    std::unordered_map<std::string_view, BTDevInfPooledValue*> values; // Keyed by the value's own octets
+    size_t value_bytes;
+};
+
+#endif // BTDEVINFVALUEPOOL_H
@@ -1,7 +1,7 @@
 #include "ble_device_information_service.h"
 
 void bleStartDeviceInformationService() {
-  BTDevInf device_info = BTDevInf(NimBLEDevice::getServer());
+  BTDevInf device_info(NimBLEDevice::getServer());
   
   // Set basic device information
   device_info.setModelNumberString("MODEL-1");
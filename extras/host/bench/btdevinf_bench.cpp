@@ -0,0 +1,1499 @@
+/**
+ * @brief Host benchmark suite for BTDevInf
+ * @note Runs BTDevInf against the NimBLE stand-in and prints one JSON object per line on stdout so results can be collected and compared from run to run.
+ * @note Usage: btdevinf_bench [iterations]
+ */
+
+#include <BTDevInf.h>
+#include <BTDevInfCache.h>
+#include <BTDevInfClient.h>
+#include <BTDevInfRegulatory.h>
+#include <BTDevInfStatic.h>
+#include <nvs.h>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+  size_t heap_allocations = 0;
+  size_t heap_bytes = 0;
+  size_t heap_live_bytes = 0;
+
+  struct HeapUsage {
+    size_t allocations;
+    size_t bytes;
+  };
+
+  HeapUsage heapUsage() {
+    return {heap_allocations, heap_bytes};
+  }
+
+  HeapUsage heapUsageSince(const HeapUsage& start) {
+    return {heap_allocations - start.allocations, heap_bytes - start.bytes};
+  }
+
+  double nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Values used by the AllDeviceInfo example
+  const uint8_t SYSTEM_ID[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0};
+  const uint8_t IEEE_DATA[] = {0x01, 0x02, 0x03, 0x04};
+  const char UDI[] = "(01)12345678901234";
+
+  struct Setter {
+    const char* name;
+    void (*call)(BTDevInf& device_info);
+  };
+
+  const Setter SETTERS[] = {
+    {"setSystemID", [](BTDevInf& d) { d.setSystemID(SYSTEM_ID, sizeof(SYSTEM_ID)); }},
+    {"setModelNumberString", [](BTDevInf& d) { d.setModelNumberString("EX-1000"); }},
+    {"setSerialNumberString", [](BTDevInf& d) { d.setSerialNumberString("SN123456789"); }},
+    {"setFirmwareRevisionString", [](BTDevInf& d) { d.setFirmwareRevisionString("1.0.0"); }},
+    {"setHardwareRevisionString", [](BTDevInf& d) { d.setHardwareRevisionString("Rev A"); }},
+    {"setSoftwareRevisionString", [](BTDevInf& d) { d.setSoftwareRevisionString("1.0.0"); }},
+    {"setManufacturerNameString", [](BTDevInf& d) { d.setManufacturerNameString("Example Corp"); }},
+    {"setIEEERegulatoryCertificationDataList", [](BTDevInf& d) { d.setIEEERegulatoryCertificationDataList(IEEE_DATA, sizeof(IEEE_DATA)); }},
+    {"setPnPID", [](BTDevInf& d) { d.setPnPID(0x02, 0x303A, 0x1001, 0x0100); }},
+    {"setUDIForMedicalDevices", [](BTDevInf& d) { d.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(UDI), sizeof(UDI) - 1); }}
+  };
+
+  void applyAllDeviceInfo(BTDevInf& device_info) {
+    for (const Setter& setter : SETTERS) {
+      setter.call(device_info);
+    }
+  }
+
+  // The same profile as static storage, PnP ID already in its 7-byte wire layout
+  const uint8_t PNP_ID[] = {0x02, 0x3A, 0x30, 0x01, 0x10, 0x00, 0x01};
+
+  void applyAllDeviceInfoStatic(BTDevInf& device_info, bool skip_long_values = false) {
+    device_info.setStaticValue(BTDevInfCharacteristic::SYSTEM_ID, SYSTEM_ID, sizeof(SYSTEM_ID));
+    device_info.setStaticValue(BTDevInfCharacteristic::MODEL_NUMBER_STRING, "EX-1000");
+    device_info.setStaticValue(BTDevInfCharacteristic::SERIAL_NUMBER_STRING, "SN123456789");
+    device_info.setStaticValue(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, "1.0.0");
+    device_info.setStaticValue(BTDevInfCharacteristic::HARDWARE_REVISION_STRING, "Rev A");
+    device_info.setStaticValue(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, "1.0.0");
+    device_info.setStaticValue(BTDevInfCharacteristic::MANUFACTURER_NAME_STRING, "Example Corp");
+    device_info.setStaticValue(BTDevInfCharacteristic::PNP_ID, PNP_ID, sizeof(PNP_ID));
+    if (!skip_long_values) {
+      device_info.setStaticValue(BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST, IEEE_DATA, sizeof(IEEE_DATA));
+      device_info.setStaticValue(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES, UDI);
+    }
+  }
+
+  // Reads every characteristic over an authenticated link, returns the number of octets received
+  size_t readAll(BTDevInf& device_info) {
+    NimBLEConnInfo conn_info(1, 23, true, true);
+    std::vector<uint8_t> value;
+    size_t received = 0;
+    for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+      NimBLECharacteristic* characteristic = device_info.getCharacteristic(static_cast<BTDevInfCharacteristic>(i));
+      if (characteristic == nullptr) continue;
+      NimBLEStandIn::readLong(characteristic, conn_info, value);
+      received += value.size();
+    }
+    return received;
+  }
+
+  void benchConstructor(int iterations) {
+    double total_ns = 0;
+    HeapUsage total = {0, 0};
+
+    for (int i = 0; i < iterations; i++) {
+      NimBLEDevice::init("BTDevInf Bench");
+      NimBLEServer* server = NimBLEDevice::createServer();
+
+      HeapUsage start_heap = heapUsage();
+      auto start = std::chrono::steady_clock::now();
+      BTDevInf device_info(server);
+      total_ns += nanosecondsSince(start);
+      HeapUsage used = heapUsageSince(start_heap);
+      total.allocations += used.allocations;
+      total.bytes += used.bytes;
+
+      NimBLEDevice::deinit(true);
+    }
+
+    printf("{\"benchmark\":\"constructor\",\"iterations\":%d,\"ns_per_op\":%.1f,\"allocations_per_op\":%.2f,\"bytes_per_op\":%.1f}\n",
+      iterations, total_ns / iterations, double(total.allocations) / iterations, double(total.bytes) / iterations);
+  }
+
+  void benchSetters(int iterations) {
+    for (const Setter& setter : SETTERS) {
+      double create_ns = 0;
+      double update_ns = 0;
+      HeapUsage create_heap = {0, 0};
+      HeapUsage update_heap = {0, 0};
+
+      for (int i = 0; i < iterations; i++) {
+        NimBLEDevice::init("BTDevInf Bench");
+        BTDevInf device_info(NimBLEDevice::createServer());
+
+        // First call creates the characteristic and its descriptors
+        HeapUsage start_heap = heapUsage();
+        auto start = std::chrono::steady_clock::now();
+        setter.call(device_info);
+        create_ns += nanosecondsSince(start);
+        HeapUsage used = heapUsageSince(start_heap);
+        create_heap.allocations += used.allocations;
+        create_heap.bytes += used.bytes;
+
+        // Second call only updates the value
+        start_heap = heapUsage();
+        start = std::chrono::steady_clock::now();
+        setter.call(device_info);
+        update_ns += nanosecondsSince(start);
+        used = heapUsageSince(start_heap);
+        update_heap.allocations += used.allocations;
+        update_heap.bytes += used.bytes;
+
+        NimBLEDevice::deinit(true);
+      }
+
+      printf("{\"benchmark\":\"setter\",\"name\":\"%s\",\"iterations\":%d,"
+        "\"create_ns_per_op\":%.1f,\"create_allocations_per_op\":%.2f,\"create_bytes_per_op\":%.1f,"
+        "\"update_ns_per_op\":%.1f,\"update_allocations_per_op\":%.2f,\"update_bytes_per_op\":%.1f}\n",
+        setter.name, iterations,
+        create_ns / iterations, double(create_heap.allocations) / iterations, double(create_heap.bytes) / iterations,
+        update_ns / iterations, double(update_heap.allocations) / iterations, double(update_heap.bytes) / iterations);
+    }
+  }
+
+  // Longer than any std::string small-buffer, so a temporary std::string of it allocates
+  const char LONG_NAME[] = "Example Corporation Industrial Division";
+  const size_t LONG_NAME_LENGTH = sizeof(LONG_NAME) - 1;
+
+  struct Update {
+    const char* name;
+    void (*call)(BTDevInf& device_info, size_t length); // Sets a value of length octets, at most LONG_NAME_LENGTH
+  };
+
+  const std::string LONG_NAME_STRING(LONG_NAME);
+
+  const Update UPDATES[] = {
+    {"string_literal", [](BTDevInf& d, size_t) { d.setManufacturerNameString(LONG_NAME); }},
+    {"char_buffer", [](BTDevInf& d, size_t length) { d.setManufacturerNameString(LONG_NAME, length); }},
+    {"string_view", [](BTDevInf& d, size_t length) { d.setManufacturerNameString(std::string_view(LONG_NAME, length)); }},
+    {"std_string", [](BTDevInf& d, size_t) { d.setManufacturerNameString(LONG_NAME_STRING); }},
+    {"bytes", [](BTDevInf& d, size_t length) { d.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(LONG_NAME), length); }},
+    {"all_device_info", [](BTDevInf& d, size_t) { applyAllDeviceInfo(d); }},
+    // What every string literal cost when the setters took const std::string&
+    {"std_string_temporary", [](BTDevInf& d, size_t length) { d.setManufacturerNameString(std::string(LONG_NAME, length)); }}
+  };
+
+  void benchSetterAllocations(int iterations) {
+    for (const Update& update : UPDATES) {
+      NimBLEDevice::init("BTDevInf Bench");
+      BTDevInf device_info(NimBLEDevice::createServer());
+      update.call(device_info, LONG_NAME_LENGTH);
+      applyAllDeviceInfo(device_info);
+
+      // Lengths vary, but never beyond the first value, which sized the characteristic buffers
+      NimBLEStandIn::resetCounters();
+      HeapUsage start_heap = heapUsage();
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        update.call(device_info, LONG_NAME_LENGTH - i % 20);
+      }
+      double ns = nanosecondsSince(start);
+      HeapUsage used = heapUsageSince(start_heap);
+
+      printf("{\"benchmark\":\"setter_allocations\",\"name\":\"%s\",\"updates\":%d,\"ns_per_update\":%.1f,\"allocations\":%zu,\"value_buffer_allocations\":%u}\n",
+        update.name, iterations, ns / iterations, used.allocations, NimBLEStandIn::counters().value_allocations);
+
+      NimBLEDevice::deinit(true);
+    }
+  }
+
+  void benchAllDeviceInfoProfile(int iterations) {
+    double total_ns = 0;
+    HeapUsage total = {0, 0};
+    size_t characteristic_count = 0;
+    uint16_t service_handles = 0;
+    uint16_t server_handles = 0;
+
+    for (int i = 0; i < iterations; i++) {
+      NimBLEDevice::init("BTDevInf Bench");
+      NimBLEServer* server = NimBLEDevice::createServer();
+
+      HeapUsage start_heap = heapUsage();
+      auto start = std::chrono::steady_clock::now();
+      {
+        BTDevInf device_info(server);
+        applyAllDeviceInfo(device_info);
+        device_info.startService();
+      }
+      total_ns += nanosecondsSince(start);
+      HeapUsage used = heapUsageSince(start_heap);
+      total.allocations += used.allocations;
+      total.bytes += used.bytes;
+
+      server->start();
+      NimBLEService* service = server->getServiceByUUID(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
+      characteristic_count = service->getCharacteristics().size();
+      service_handles = service->getEndHandle() - service->getHandle() + 1;
+      server_handles = server->getAttributeCount();
+
+      NimBLEDevice::deinit(true);
+    }
+
+    printf("{\"benchmark\":\"all_device_info_profile\",\"iterations\":%d,\"ns_per_op\":%.1f,\"allocations_per_op\":%.2f,\"bytes_per_op\":%.1f,"
+      "\"characteristics\":%zu,\"service_attribute_handles\":%u,\"server_attribute_handles\":%u,\"allocations_per_characteristic\":%.2f}\n",
+      iterations, total_ns / iterations, double(total.allocations) / iterations, double(total.bytes) / iterations,
+      characteristic_count, service_handles, server_handles, double(total.allocations) / iterations / characteristic_count);
+  }
+
+  void benchBuilder(int iterations) {
+    double total_ns = 0;
+    HeapUsage total = {0, 0};
+    BTDevInf::BuildReport report = {};
+
+    for (int i = 0; i < iterations; i++) {
+      NimBLEDevice::init("BTDevInf Bench");
+      NimBLEServer* server = NimBLEDevice::createServer();
+
+      HeapUsage start_heap = heapUsage();
+      auto start = std::chrono::steady_clock::now();
+      {
+        BTDevInf device_info(server);
+        BTDevInf::Builder builder;
+        builder.setSystemID(SYSTEM_ID, sizeof(SYSTEM_ID))
+          .setModelNumberString("EX-1000")
+          .setSerialNumberString("SN123456789")
+          .setFirmwareRevisionString("1.0.0")
+          .setHardwareRevisionString("Rev A")
+          .setSoftwareRevisionString("1.0.0")
+          .setManufacturerNameString("Example Corp")
+          .setIEEERegulatoryCertificationDataList(IEEE_DATA, sizeof(IEEE_DATA))
+          .setPnPID(0x02, 0x303A, 0x1001, 0x0100)
+          .setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(UDI), sizeof(UDI) - 1);
+        report = device_info.commit(builder);
+        device_info.startService();
+      }
+      total_ns += nanosecondsSince(start);
+      HeapUsage used = heapUsageSince(start_heap);
+      total.allocations += used.allocations;
+      total.bytes += used.bytes;
+
+      NimBLEDevice::deinit(true);
+    }
+
+    printf("{\"benchmark\":\"builder_profile\",\"iterations\":%d,\"ns_per_op\":%.1f,\"allocations_per_op\":%.2f,\"bytes_per_op\":%.1f,"
+      "\"success\":%s,\"characteristics\":%u,\"attribute_handles\":%u,\"value_bytes\":%zu}\n",
+      iterations, total_ns / iterations, double(total.allocations) / iterations, double(total.bytes) / iterations,
+      report.success ? "true" : "false", report.characteristic_count, report.attribute_count, report.value_bytes);
+  }
+
+  void benchValueProviders() {
+    static uint32_t provider_calls = 0;
+    BTDevInfValueProvider system_id_provider = [](uint8_t* buffer, size_t capacity, void*) -> size_t {
+      provider_calls++;
+      if (capacity < sizeof(SYSTEM_ID)) return 0;
+      memcpy(buffer, SYSTEM_ID, sizeof(SYSTEM_ID));
+      return sizeof(SYSTEM_ID);
+    };
+
+    NimBLEDevice::init("BTDevInf Bench");
+    {
+      BTDevInf device_info(NimBLEDevice::createServer());
+      device_info.setValueProvider(BTDevInfCharacteristic::SYSTEM_ID, system_id_provider, nullptr, sizeof(SYSTEM_ID));
+      device_info.startService();
+      uint32_t calls_at_boot = provider_calls;
+
+      NimBLECharacteristic* characteristic = device_info.getSystemIDCharacteristic();
+      NimBLEConnInfo unauthenticated(1, 23, true, false);
+      NimBLEConnInfo authenticated(2, 23, true, true);
+      std::vector<uint8_t> value;
+
+      NimBLEStandIn::readLong(characteristic, unauthenticated, value);
+      uint32_t calls_after_rejected_read = provider_calls;
+      for (int i = 0; i < 10; i++) {
+        NimBLEStandIn::readLong(characteristic, authenticated, value);
+      }
+      uint32_t calls_after_reads = provider_calls;
+      bool value_matches = value.size() == sizeof(SYSTEM_ID) && memcmp(value.data(), SYSTEM_ID, sizeof(SYSTEM_ID)) == 0;
+      device_info.invalidateValue(BTDevInfCharacteristic::SYSTEM_ID);
+      NimBLEStandIn::readLong(characteristic, authenticated, value);
+      uint32_t calls_after_invalidate = provider_calls;
+
+      printf("{\"benchmark\":\"value_provider\",\"calls_at_boot\":%u,\"calls_after_rejected_read\":%u,\"calls_after_10_reads\":%u,\"calls_after_invalidate_and_read\":%u,\"value_matches\":%s}\n",
+        calls_at_boot, calls_after_rejected_read, calls_after_reads, calls_after_invalidate, value_matches ? "true" : "false");
+    }
+    NimBLEDevice::deinit(true);
+  }
+
+  void benchInstrumentation(int iterations) {
+    const char* modes[] = {"off", "on"};
+
+    for (int mode = 0; mode < 2; mode++) {
+      NimBLEDevice::init("BTDevInf Bench");
+      {
+        BTDevInf device_info(NimBLEDevice::createServer());
+        if (mode == 1) device_info.enableInstrumentation();
+        applyAllDeviceInfo(device_info);
+        device_info.startService();
+
+        // Two clients take turns, each reading the whole profile twice per connection and then disconnecting; the stack hands their handles out again
+        NimBLEConnInfo clients[] = {NimBLEConnInfo(1, 23, true, true), NimBLEConnInfo(2, 23, true, true)};
+        NimBLEConnInfo unauthenticated(3, 23, true, false);
+        std::vector<uint8_t> value;
+        size_t reads = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+          NimBLEConnInfo& conn_info = clients[(i / 2) % 2];
+          for (size_t c = 0; c < BTDEVINF_CHARACTERISTIC_COUNT; c++) {
+            NimBLEStandIn::readLong(device_info.getCharacteristic(static_cast<BTDevInfCharacteristic>(c)), conn_info, value);
+            reads++;
+          }
+          if (i % 2 == 1) device_info.onDisconnect(conn_info);
+        }
+        double read_ns = nanosecondsSince(start) / reads;
+        uint32_t connections = (iterations + 1) / 2;
+        // Rejected by the stack before any callback, so it is not counted
+        NimBLEStandIn::readLong(device_info.getSerialNumberStringCharacteristic(), unauthenticated, value);
+
+        BTDevInf::InstrumentationSnapshot snapshot;
+        HeapUsage start_heap = heapUsage();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+          device_info.getInstrumentationSnapshot(snapshot);
+        }
+        double snapshot_ns = nanosecondsSince(start) / iterations;
+        HeapUsage snapshot_heap = heapUsageSince(start_heap);
+
+        const BTDevInf::CharacteristicStats& serial = snapshot.characteristics[static_cast<size_t>(BTDevInfCharacteristic::SERIAL_NUMBER_STRING)];
+        printf("{\"benchmark\":\"instrumentation\",\"mode\":\"%s\",\"reads\":%zu,\"ns_per_read\":%.1f,\"snapshot_ns\":%.1f,\"snapshot_allocations\":%zu,"
+          "\"serial_read_count\":%u,\"connections\":%u,\"serial_connection_count\":%u,\"value_bytes\":%zu,\"descriptor_bytes\":%zu,\"static_bytes\":%zu,\"published_bytes\":%zu}\n",
+          modes[mode], reads, read_ns, snapshot_ns, snapshot_heap.allocations,
+          serial.read_count, connections, serial.connection_count,
+          snapshot.value_bytes, snapshot.descriptor_bytes, snapshot.static_bytes, snapshot.published_bytes);
+      }
+      NimBLEDevice::deinit(true);
+    }
+  }
+
+  void benchClient() {
+    // A production-length UDI so that values also continue past the MTU
+    static const char LONG_UDI[] = "(01)00643169007222(17)260128(10)A213B1(21)1234567890ABCDEF";
+    const uint16_t mtus[] = {23, 185, 247};
+    const char* methods[] = {"read_multiple_variable", "queued_reads", "sequential_read_value"};
+
+    for (uint16_t mtu : mtus) {
+      for (int authenticated = 1; authenticated >= 0; authenticated--) {
+        for (int method = 0; method < 3; method++) {
+          NimBLEDevice::init("BTDevInf Bench");
+          NimBLEServer* server = NimBLEDevice::createServer();
+          BTDevInf device_info(server);
+          applyAllDeviceInfo(device_info);
+          device_info.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(LONG_UDI), sizeof(LONG_UDI) - 1);
+          device_info.startService();
+          server->start();
+
+          NimBLEClient* client = NimBLEDevice::createClient();
+          NimBLEStandIn::connect(client, server, NimBLEConnInfo(1, mtu, authenticated, authenticated), method == 0);
+          NimBLEStandIn::resetCounters();
+
+          BTDevInfClient reader(client);
+          size_t fields = 0;
+          bool values_match = true;
+          if (method < 2) {
+            BTDevInfClient::ReadReport report = reader.read();
+            fields = report.characteristic_count;
+            for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+              BTDevInfCharacteristic characteristic = static_cast<BTDevInfCharacteristic>(i);
+              if (!reader.hasValue(characteristic)) continue;
+              const NimBLEAttValue& expected = device_info.getCharacteristic(characteristic)->getAttVal();
+              const std::vector<uint8_t>& value = reader.getValue(characteristic);
+              if (value.size() != expected.size() || memcmp(value.data(), expected.data(), value.size()) != 0) values_match = false;
+            }
+            BTDevInfPnPID pnp_id;
+            if (!reader.getPnPID(pnp_id) || pnp_id.vendor_id != 0x303A || pnp_id.product_id != 0x1001 || pnp_id.product_version != 0x0100) values_match = false;
+          } else {
+            // The baseline: one blocking readValue() per characteristic
+            NimBLERemoteService* service = client->getService(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
+            for (NimBLERemoteCharacteristic* characteristic : service->getCharacteristics(true)) {
+              if (characteristic->readValue().size() > 0) fields++;
+            }
+          }
+
+          NimBLEStandIn::Counters counters = NimBLEStandIn::counters();
+          printf("{\"benchmark\":\"client_read\",\"method\":\"%s\",\"mtu\":%u,\"authenticated\":%s,\"att_requests\":%u,\"task_waits\":%u,\"fields_read\":%zu,\"values_match\":%s}\n",
+            methods[method], mtu, authenticated ? "true" : "false", counters.att_requests, counters.task_waits, fields, values_match ? "true" : "false");
+
+          NimBLEDevice::deinit(true);
+        }
+      }
+    }
+  }
+
+  void benchClientCache(int peers) {
+    static const char CACHE_PATH[] = "btdevinf_bench_cache.bin";
+
+    NimBLEDevice::init("BTDevInf Bench");
+    NimBLEServer* server = NimBLEDevice::createServer();
+    BTDevInf device_info(server);
+    applyAllDeviceInfo(device_info);
+    device_info.startService();
+    server->start();
+
+    NimBLEClient* client = NimBLEDevice::createClient();
+    NimBLEStandIn::connect(client, server, NimBLEConnInfo(1, 23, true, true));
+    auto peerAddress = [](int peer) {
+      uint8_t address[6] = {static_cast<uint8_t>(peer), static_cast<uint8_t>(peer >> 8), 0x00, 0x3A, 0x30, 0xC0};
+      return NimBLEAddress(address, 1);
+    };
+
+    // First connection to every peer reads the service and fills the cache
+    BTDevInfCache cache;
+    NimBLEStandIn::resetCounters();
+    for (int peer = peers - 1; peer >= 0; peer--) {
+      client->setPeerAddress(peerAddress(peer));
+      BTDevInfClient reader(client);
+      reader.read(cache);
+    }
+    uint32_t cold_requests = NimBLEStandIn::counters().att_requests;
+    bool saved = cache.saveFile(CACHE_PATH);
+
+    // Reconnects after a restart, from the mapped file
+    BTDevInfCache mapped;
+    bool loaded = mapped.loadFile(CACHE_PATH);
+    NimBLEStandIn::resetCounters();
+    size_t from_cache = 0;
+    bool values_match = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int peer = 0; peer < peers; peer++) {
+      client->setPeerAddress(peerAddress(peer));
+      BTDevInfClient reader(client);
+      if (reader.read(mapped).from_cache) from_cache++;
+      BTDevInfPnPID pnp_id;
+      if (!reader.getPnPID(pnp_id) || pnp_id.product_id != 0x1001 || reader.getFirmwareRevisionString() != "1.0.0") values_match = false;
+    }
+    double warm_ns = nanosecondsSince(start) / peers;
+    uint32_t warm_requests = NimBLEStandIn::counters().att_requests;
+
+    BTDevInfCacheRecord record;
+    start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (int peer = 0; peer < peers; peer++) {
+      if (mapped.find(peerAddress(peer), record)) found++;
+    }
+    double lookup_ns = nanosecondsSince(start) / peers;
+
+    // A peer reports new firmware: only that one is read again
+    bool invalidated = mapped.invalidateIfFirmwareChanged(peerAddress(0), "1.1.0", 5);
+    bool kept = !mapped.invalidateIfFirmwareChanged(peerAddress(1), "1.0.0", 5);
+    NimBLEStandIn::resetCounters();
+    for (int peer = 0; peer < peers; peer++) {
+      client->setPeerAddress(peerAddress(peer));
+      BTDevInfClient reader(client);
+      reader.read(mapped);
+    }
+    uint32_t after_update_requests = NimBLEStandIn::counters().att_requests;
+
+    // A peer read before pairing refuses the authenticated values; that read is not cached, so the one after pairing reads them
+    NimBLEStandIn::connect(client, server, NimBLEConnInfo(1, 23, true, false));
+    client->setPeerAddress(peerAddress(peers));
+    BTDevInfClient unpaired(client);
+    BTDevInfClient::ReadReport unpaired_report = unpaired.read(mapped);
+    bool auth_failure_reported = unpaired.getStatus(BTDevInfCharacteristic::SERIAL_NUMBER_STRING) == BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHEN);
+    bool auth_failure_cached = mapped.find(peerAddress(peers), record);
+    NimBLEStandIn::connect(client, server, NimBLEConnInfo(1, 23, true, true));
+    BTDevInfClient paired(client);
+    BTDevInfClient::ReadReport paired_report = paired.read(mapped);
+    bool paired_read_complete = !paired_report.from_cache && paired_report.characteristic_count > unpaired_report.characteristic_count && paired.hasValue(BTDevInfCharacteristic::SERIAL_NUMBER_STRING);
+
+    // A damaged file is rejected rather than searched
+    FILE* file = fopen(CACHE_PATH, "r+b");
+    if (file != nullptr) {
+      fseek(file, 8, SEEK_SET);
+      fputc(0xFF, file);
+      fclose(file);
+    }
+    BTDevInfCache damaged;
+    bool damaged_rejected = !damaged.loadFile(CACHE_PATH);
+    remove(CACHE_PATH);
+
+    printf("{\"benchmark\":\"client_cache\",\"peers\":%d,\"file_bytes\":%zu,\"bytes_per_peer\":%.1f,\"saved\":%s,\"mapped\":%s,"
+      "\"cold_att_requests\":%u,\"warm_att_requests\":%u,\"warm_from_cache\":%zu,\"warm_ns_per_peer\":%.1f,\"lookup_ns\":%.1f,\"found\":%zu,"
+      "\"firmware_change_invalidated\":%s,\"unchanged_kept\":%s,\"att_requests_after_firmware_change\":%u,\"damaged_file_rejected\":%s,\"values_match\":%s,"
+      "\"auth_failure_reported\":%s,\"auth_failure_cached\":%s,\"paired_read_complete\":%s}\n",
+      peers, cache.getImageSize(), static_cast<double>(cache.getImageSize()) / peers, saved ? "true" : "false", loaded ? "true" : "false",
+      cold_requests, warm_requests, from_cache, warm_ns, lookup_ns, found,
+      invalidated ? "true" : "false", kept ? "true" : "false", after_update_requests, damaged_rejected ? "true" : "false", values_match ? "true" : "false",
+      auth_failure_reported ? "true" : "false", auth_failure_cached ? "true" : "false", paired_read_complete ? "true" : "false");
+
+    NimBLEDevice::deinit(true);
+  }
+
+  // Finds the manufacturer data AD structure in a payload, returns its data after the type octet
+  bool findManufacturerData(const std::vector<uint8_t>& payload, const uint8_t*& data, size_t& length) {
+    for (size_t position = 0; position + 1 < payload.size(); position += payload[position] + 1) {
+      if (payload[position + 1] == BLE_HS_ADV_TYPE_MFG_DATA) {
+        data = payload.data() + position + 2;
+        length = payload[position] - 1;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void benchAdvertising() {
+    static const char LONG_MODEL[] = "EX-1000-PRO-INDUSTRIAL-GATEWAY";
+
+    NimBLEDevice::init("BTDevInf Bench");
+    NimBLEServer* server = NimBLEDevice::createServer();
+    BTDevInf device_info(server);
+    applyAllDeviceInfo(device_info);
+    device_info.startService();
+    server->start();
+
+    NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
+    advertising->start();
+    bool set = device_info.setAdvertising(advertising);
+
+    const uint8_t* data;
+    size_t length;
+    BTDevInfAdvertisedInfo info;
+    std::vector<uint8_t> scan_response = advertising->getScanResponseData().getPayload();
+    bool decoded = findManufacturerData(scan_response, data, length) && BTDevInfClient::decodeManufacturerData(data, length, info);
+    bool matches = decoded && info.pnp_id.vendor_id == 0x303A && info.pnp_id.product_id == 0x1001 && info.pnp_id.product_version == 0x0100
+      && info.firmware_revision == "1.0.0" && info.model_number == "EX-1000" && info.company_id == 0xFFFF;
+    size_t scan_response_octets = scan_response.size();
+
+    // Setters keep the scan response in sync
+    uint32_t updates_before = advertising->getDataUpdates();
+    device_info.setFirmwareRevisionString("1.1.0");
+    device_info.setModelNumberString(LONG_MODEL);
+    scan_response = advertising->getScanResponseData().getPayload();
+    bool in_sync = findManufacturerData(scan_response, data, length) && BTDevInfClient::decodeManufacturerData(data, length, info)
+      && info.firmware_revision == "1.1.0" && !info.firmware_revision_truncated && info.model_number_truncated
+      && info.model_number == std::string(LONG_MODEL, info.model_number.size());
+    size_t legacy_model_octets = info.model_number.size();
+    size_t long_scan_response_octets = scan_response.size();
+    uint32_t setter_updates = advertising->getDataUpdates() - updates_before;
+
+    BTDevInfAdvertisingOptions extended;
+    extended.max_length = BTDEVINF_EXTENDED_ADVERTISING_LENGTH;
+    uint8_t extended_data[BTDEVINF_EXTENDED_ADVERTISING_LENGTH];
+    size_t extended_length = device_info.buildManufacturerData(extended_data, sizeof(extended_data), extended);
+    bool extended_complete = BTDevInfClient::decodeManufacturerData(extended_data, extended_length, info) && !info.model_number_truncated && info.model_number == LONG_MODEL;
+
+    // What a scanner would spend connecting instead
+    NimBLEClient* client = NimBLEDevice::createClient();
+    NimBLEStandIn::connect(client, server, NimBLEConnInfo(1, 23, true, false));
+    NimBLEStandIn::resetCounters();
+    BTDevInfClient reader(client);
+    reader.read();
+
+    printf("{\"benchmark\":\"advertising\",\"set\":%s,\"scan_response_octets\":%zu,\"decoded_matches\":%s,\"setter_updates\":%u,\"in_sync_after_setters\":%s,"
+      "\"long_model_scan_response_octets\":%zu,\"long_model_advertised_octets\":%zu,\"extended_octets\":%zu,\"extended_complete\":%s,\"att_requests_to_read_over_gatt\":%u}\n",
+      set ? "true" : "false", scan_response_octets, matches ? "true" : "false", setter_updates, in_sync ? "true" : "false",
+      long_scan_response_octets, legacy_model_octets, extended_length, extended_complete ? "true" : "false", NimBLEStandIn::counters().att_requests);
+
+    NimBLEDevice::deinit(true);
+  }
+
+  // Every published value is one octet repeated, and its length follows from that octet, so a torn read is detectable
+  size_t fillPattern(uint8_t* buffer, uint8_t octet, size_t max_length) {
+    size_t length = 1 + octet % max_length;
+    memset(buffer, octet, length);
+    return length;
+  }
+
+  bool isPattern(const std::vector<uint8_t>& value, size_t max_length) {
+    if (value.empty() || value.size() != 1 + value[0] % max_length) return false;
+    for (uint8_t octet : value) {
+      if (octet != value[0]) return false;
+    }
+    return true;
+  }
+
+  void benchConcurrentUpdates(int milliseconds) {
+    const uint16_t SHORT_LENGTH = 64;  // Two writers, fits one ATT_MTU 185 read
+    const uint16_t LONG_LENGTH = 200;  // One writer, read with Read Blob requests at ATT_MTU 23
+
+    NimBLEDevice::init("BTDevInf Bench");
+    NimBLEServer* server = NimBLEDevice::createServer();
+    BTDevInf device_info(server);
+    device_info.setFirmwareRevisionString("1.0.0");
+    bool enabled = device_info.enableConcurrentUpdates(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, SHORT_LENGTH)
+      && device_info.enableConcurrentUpdates(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, LONG_LENGTH);
+    device_info.startService();
+    server->start();
+
+    // The value set before enabling is kept
+    std::vector<uint8_t> value;
+    NimBLEConnInfo conn_info(1, 185, true, true);
+    NimBLEStandIn::readLong(device_info.getFirmwareRevisionStringCharacteristic(), conn_info, value);
+    bool kept = std::string(value.begin(), value.end()) == "1.0.0";
+
+    // Uncontended cost of a concurrent update
+    uint8_t pattern[LONG_LENGTH];
+    const int UNCONTENDED = 100000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < UNCONTENDED; i++) {
+      size_t length = fillPattern(pattern, i, SHORT_LENGTH);
+      device_info.setValue(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, pattern, length);
+    }
+    double publish_ns = nanosecondsSince(start) / UNCONTENDED;
+    size_t long_length = fillPattern(pattern, 0, LONG_LENGTH);
+    device_info.setValue(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, pattern, long_length);
+
+    std::atomic<bool> go(false);
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> writes(0);
+    uint32_t reads = 0;
+    uint32_t torn_reads = 0;
+
+    auto writer = [&](BTDevInfCharacteristic characteristic, uint16_t max_length, uint8_t first) {
+      uint8_t buffer[LONG_LENGTH];
+      while (!go) {}
+      for (uint8_t octet = first; !stop; octet += 2) {
+        size_t length = fillPattern(buffer, octet, max_length);
+        device_info.setValue(characteristic, buffer, length);
+        writes.fetch_add(1, std::memory_order_relaxed);
+      }
+    };
+
+    // Threads are created before any of them runs, so only the reader allocates while they are running
+    std::thread writers[] = {
+      std::thread(writer, BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, SHORT_LENGTH, 0),
+      std::thread(writer, BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, SHORT_LENGTH, 1),
+      std::thread(writer, BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, LONG_LENGTH, 0)
+    };
+    std::thread reader([&]() {
+      std::vector<uint8_t> read_value;
+      NimBLEConnInfo short_mtu(2, 23, true, true);
+      NimBLEConnInfo long_mtu(3, 185, true, true);
+      while (!go) {}
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+      while (std::chrono::steady_clock::now() < deadline) {
+        NimBLEStandIn::readLong(device_info.getFirmwareRevisionStringCharacteristic(), long_mtu, read_value);
+        if (!isPattern(read_value, SHORT_LENGTH)) torn_reads++;
+        NimBLEStandIn::readLong(device_info.getSoftwareRevisionStringCharacteristic(), short_mtu, read_value);
+        if (!isPattern(read_value, LONG_LENGTH)) torn_reads++;
+        reads += 2;
+      }
+      stop = true;
+    });
+
+    go = true;
+    reader.join();
+    for (std::thread& thread : writers) thread.join();
+
+    printf("{\"benchmark\":\"concurrent_updates\",\"enabled\":%s,\"value_kept\":%s,\"publish_ns\":%.1f,\"writer_threads\":3,\"reader_threads\":1,"
+      "\"milliseconds\":%d,\"writes\":%u,\"reads\":%u,\"torn_reads\":%u}\n",
+      enabled ? "true" : "false", kept ? "true" : "false", publish_ns, milliseconds, writes.load(), reads, torn_reads);
+
+    NimBLEDevice::deinit(true);
+  }
+
+  struct NvsKey {
+    const char* key;
+    BTDevInfCharacteristic characteristic;
+  };
+
+  const NvsKey NVS_KEYS[] = {
+    {"system_id", BTDevInfCharacteristic::SYSTEM_ID},
+    {"model", BTDevInfCharacteristic::MODEL_NUMBER_STRING},
+    {"serial", BTDevInfCharacteristic::SERIAL_NUMBER_STRING},
+    {"firmware", BTDevInfCharacteristic::FIRMWARE_REVISION_STRING},
+    {"hardware", BTDevInfCharacteristic::HARDWARE_REVISION_STRING},
+    {"software", BTDevInfCharacteristic::SOFTWARE_REVISION_STRING},
+    {"manufacturer", BTDevInfCharacteristic::MANUFACTURER_NAME_STRING},
+    {"ieee", BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST},
+    {"pnp_id", BTDevInfCharacteristic::PNP_ID},
+    {"udi", BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES}
+  };
+
+  // Configuration that lives in code rather than in NVS
+  void configureForSnapshot(BTDevInf& device_info) {
+    device_info.setDescriptorPolicy(BTDevInfDescriptorPolicy::PRESENTATION_FORMAT_ONLY);
+    device_info.enableConcurrentUpdates(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, 32);
+  }
+
+  // The boot path a snapshot replaces: one NVS read and one setter per value
+  void bootFromNvsKeys(BTDevInf& device_info, nvs_handle_t handle) {
+    configureForSnapshot(device_info);
+    uint8_t value[BLE_ATT_ATTR_MAX_LEN];
+    for (const NvsKey& key : NVS_KEYS) {
+      size_t length = sizeof(value);
+      if (nvs_get_blob(handle, key.key, value, &length) == ESP_OK) {
+        device_info.setValue(key.characteristic, value, length);
+      }
+    }
+  }
+
+  BTDevInf::BuildReport bootFromSnapshot(BTDevInf& device_info, nvs_handle_t handle) {
+    BTDevInf::BuildReport report = {};
+    size_t length = 0;
+    if (nvs_get_blob(handle, "dis", nullptr, &length) != ESP_OK) return report;
+
+    uint8_t* snapshot = new uint8_t[length];
+    if (nvs_get_blob(handle, "dis", snapshot, &length) == ESP_OK) {
+      report = device_info.restoreSnapshot(snapshot, length);
+    }
+    delete[] snapshot;
+    return report;
+  }
+
+  // Every characteristic value, empty for characteristics that do not exist, then the attribute count
+  std::vector<std::vector<uint8_t>> serviceContents(BTDevInf& device_info) {
+    NimBLEConnInfo conn_info(1, 247, true, true);
+    std::vector<std::vector<uint8_t>> contents(BTDEVINF_CHARACTERISTIC_COUNT + 1);
+    for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+      NimBLECharacteristic* characteristic = device_info.getCharacteristic(static_cast<BTDevInfCharacteristic>(i));
+      if (characteristic != nullptr) NimBLEStandIn::readLong(characteristic, conn_info, contents[i]);
+    }
+    contents[BTDEVINF_CHARACTERISTIC_COUNT].push_back(device_info.getAttributeCount());
+    return contents;
+  }
+
+  void benchSnapshot(int iterations) {
+    char directory[] = "/tmp/btdevinf_nvs_XXXXXX";
+    if (mkdtemp(directory) == nullptr) return;
+    NimBLEStandIn::setNvsDirectory(directory);
+    nvs_handle_t handle;
+    nvs_open("btdevinf", NVS_READWRITE, &handle);
+
+    // Provision both layouts from the same profile
+    size_t snapshot_length;
+    {
+      NimBLEDevice::init("BTDevInf Bench");
+      BTDevInf device_info(NimBLEDevice::createServer());
+      configureForSnapshot(device_info);
+      applyAllDeviceInfo(device_info);
+      NimBLEConnInfo conn_info(1, 247, true, true);
+      std::vector<uint8_t> value;
+      for (const NvsKey& key : NVS_KEYS) {
+        NimBLEStandIn::readLong(device_info.getCharacteristic(key.characteristic), conn_info, value);
+        nvs_set_blob(handle, key.key, value.data(), value.size());
+      }
+      std::vector<uint8_t> snapshot(device_info.getSnapshotSize());
+      snapshot_length = device_info.saveSnapshot(snapshot.data(), snapshot.size());
+      nvs_set_blob(handle, "dis", snapshot.data(), snapshot_length);
+      nvs_commit(handle);
+      NimBLEDevice::deinit(true);
+    }
+
+    const char* paths[] = {"nvs_keys", "snapshot"};
+    for (int path = 0; path < 2; path++) {
+      double total_ns = 0;
+      HeapUsage total = {0, 0};
+      NimBLEStandIn::resetCounters();
+
+      for (int i = 0; i < iterations; i++) {
+        NimBLEDevice::init("BTDevInf Bench");
+        NimBLEServer* server = NimBLEDevice::createServer();
+
+        HeapUsage start_heap = heapUsage();
+        auto start = std::chrono::steady_clock::now();
+        {
+          BTDevInf device_info(server);
+          if (path == 0) {
+            bootFromNvsKeys(device_info, handle);
+          } else {
+            bootFromSnapshot(device_info, handle);
+          }
+          device_info.startService();
+        }
+        total_ns += nanosecondsSince(start);
+        HeapUsage used = heapUsageSince(start_heap);
+        total.allocations += used.allocations;
+        total.bytes += used.bytes;
+
+        NimBLEDevice::deinit(true);
+      }
+
+      printf("{\"benchmark\":\"snapshot_boot\",\"path\":\"%s\",\"iterations\":%d,\"ns_per_op\":%.1f,\"allocations_per_op\":%.2f,\"bytes_per_op\":%.1f,\"nvs_reads_per_op\":%.2f}\n",
+        paths[path], iterations, total_ns / iterations, double(total.allocations) / iterations, double(total.bytes) / iterations,
+        double(NimBLEStandIn::counters().nvs_reads) / iterations);
+    }
+
+    // Both paths must produce the same service
+    std::vector<std::vector<uint8_t>> from_keys;
+    NimBLEDevice::init("BTDevInf Bench");
+    {
+      BTDevInf device_info(NimBLEDevice::createServer());
+      bootFromNvsKeys(device_info, handle);
+      from_keys = serviceContents(device_info);
+    }
+    NimBLEDevice::deinit(true);
+
+    BTDevInf::BuildReport report;
+    bool matches;
+    NimBLEDevice::init("BTDevInf Bench");
+    {
+      BTDevInf device_info(NimBLEDevice::createServer());
+      report = bootFromSnapshot(device_info, handle);
+      matches = serviceContents(device_info) == from_keys;
+    }
+    NimBLEDevice::deinit(true);
+
+    // Any damaged octet is caught by the checksum
+    std::vector<uint8_t> snapshot(snapshot_length);
+    size_t length = snapshot.size();
+    nvs_get_blob(handle, "dis", snapshot.data(), &length);
+    size_t rejected = 0;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+      snapshot[i] ^= 0x01;
+      if (!BTDevInf::validateSnapshot(snapshot.data(), snapshot.size())) rejected++;
+      snapshot[i] ^= 0x01;
+    }
+
+    printf("{\"benchmark\":\"snapshot\",\"snapshot_octets\":%zu,\"restored\":%s,\"characteristics\":%u,\"attribute_handles\":%u,\"matches_nvs_keys\":%s,"
+      "\"single_bit_errors_rejected\":%zu,\"single_bit_errors\":%zu}\n",
+      snapshot_length, report.success ? "true" : "false", report.characteristic_count, report.attribute_count, matches ? "true" : "false",
+      rejected, snapshot.size());
+
+    nvs_close(handle);
+    char path[sizeof(directory) + 32];
+    for (const NvsKey& key : NVS_KEYS) {
+      snprintf(path, sizeof(path), "%s/btdevinf.%s", directory, key.key);
+      remove(path);
+    }
+    snprintf(path, sizeof(path), "%s/btdevinf.dis", directory);
+    remove(path);
+    rmdir(directory);
+  }
+
+  typedef BTDevInfStatic<BTDevInfCharacteristic::MODEL_NUMBER_STRING, BTDevInfCharacteristic::FIRMWARE_REVISION_STRING,
+    BTDevInfCharacteristic::MANUFACTURER_NAME_STRING, BTDevInfCharacteristic::PNP_ID> FourFieldProfile;
+
+  template <typename DeviceInfo>
+  void applyFourFieldProfile(DeviceInfo& device_info) {
+    device_info.setModelNumberString("EX-1000");
+    device_info.setFirmwareRevisionString("1.0.0");
+    device_info.setManufacturerNameString("Example Corp");
+    device_info.setPnPID(0x02, 0x303A, 0x1001, 0x0100);
+    device_info.startService();
+  }
+
+  // The four characteristics most products use, built with BTDevInf and with BTDevInfStatic; see the size target for binary size
+  void benchStaticProfile(int iterations) {
+    const char* classes[] = {"BTDevInf", "BTDevInfStatic"};
+    const size_t sizes[] = {sizeof(BTDevInf), sizeof(FourFieldProfile)};
+    std::vector<std::vector<uint8_t>> contents[2];
+
+    for (int which = 0; which < 2; which++) {
+      double total_ns = 0;
+      HeapUsage total = {0, 0};
+      uint16_t attribute_handles = 0;
+
+      for (int i = 0; i < iterations; i++) {
+        NimBLEDevice::init("BTDevInf Bench");
+        NimBLEServer* server = NimBLEDevice::createServer();
+
+        HeapUsage start_heap = heapUsage();
+        auto start = std::chrono::steady_clock::now();
+        if (which == 0) {
+          BTDevInf device_info(server);
+          applyFourFieldProfile(device_info);
+          attribute_handles = device_info.getAttributeCount();
+        } else {
+          FourFieldProfile device_info(server);
+          applyFourFieldProfile(device_info);
+          attribute_handles = device_info.getAttributeCount();
+        }
+        total_ns += nanosecondsSince(start);
+        HeapUsage used = heapUsageSince(start_heap);
+        total.allocations += used.allocations;
+        total.bytes += used.bytes;
+
+        // Compare what a client reads, through the service since the instance is gone
+        if (i == 0) {
+          NimBLEService* service = server->getServiceByUUID(NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID));
+          NimBLEConnInfo conn_info(1, 247, true, true);
+          for (NimBLECharacteristic* characteristic : service->getCharacteristics()) {
+            contents[which].emplace_back();
+            NimBLEStandIn::readLong(characteristic, conn_info, contents[which].back());
+          }
+        }
+
+        NimBLEDevice::deinit(true);
+      }
+
+      printf("{\"benchmark\":\"static_profile\",\"class\":\"%s\",\"iterations\":%d,\"sizeof\":%zu,\"ns_per_op\":%.1f,\"allocations_per_op\":%.2f,\"bytes_per_op\":%.1f,"
+        "\"attribute_handles\":%u,\"values_match\":%s}\n",
+        classes[which], iterations, sizes[which], total_ns / iterations, double(total.allocations) / iterations, double(total.bytes) / iterations,
+        attribute_handles, contents[which] == contents[0] ? "true" : "false");
+    }
+  }
+
+  // What a regulatory list entry should decode to
+  struct RegulatoryModelEntry {
+    enum Kind { CONTINUA_VERSION, REGULATION, OPAQUE } kind;
+    uint8_t auth_body;
+    uint8_t struc_type;
+    uint8_t major_version;
+    uint8_t minor_version;
+    std::vector<uint16_t> device_classes;
+    uint16_t regulation_bits;
+    std::vector<uint8_t> data;
+  };
+
+  std::vector<RegulatoryModelEntry> randomRegulatoryList(std::mt19937& random) {
+    std::vector<RegulatoryModelEntry> entries(random() % 9);
+    for (RegulatoryModelEntry& entry : entries) {
+      entry.kind = static_cast<RegulatoryModelEntry::Kind>(random() % 3);
+      entry.major_version = random();
+      entry.minor_version = random();
+      entry.regulation_bits = random();
+      if (entry.kind == RegulatoryModelEntry::CONTINUA_VERSION) {
+        entry.device_classes.resize(random() % 80);
+        for (uint16_t& device_class : entry.device_classes) device_class = random();
+      } else if (entry.kind == RegulatoryModelEntry::OPAQUE) {
+        // Any body but Continua, whose structures the decoder interprets
+        do {
+          entry.auth_body = random();
+        } while (entry.auth_body == BTDEVINF_REGULATORY_AUTH_BODY_CONTINUA);
+        entry.struc_type = random();
+        entry.data.resize(random() % 96);
+        for (uint8_t& octet : entry.data) octet = random();
+      }
+    }
+    return entries;
+  }
+
+  size_t encodedRegulatoryLength(const std::vector<RegulatoryModelEntry>& entries) {
+    size_t length = 4;
+    for (const RegulatoryModelEntry& entry : entries) {
+      if (entry.kind == RegulatoryModelEntry::CONTINUA_VERSION) length += 4 + 6 + 2 * entry.device_classes.size();
+      if (entry.kind == RegulatoryModelEntry::REGULATION) length += 4 + 2;
+      if (entry.kind == RegulatoryModelEntry::OPAQUE) length += 4 + entry.data.size();
+    }
+    return length;
+  }
+
+  void encodeRegulatoryList(const std::vector<RegulatoryModelEntry>& entries, BTDevInfRegulatoryEncoder& encoder) {
+    for (const RegulatoryModelEntry& entry : entries) {
+      if (entry.kind == RegulatoryModelEntry::CONTINUA_VERSION) {
+        encoder.addContinuaVersion(entry.major_version, entry.minor_version);
+        for (uint16_t device_class : entry.device_classes) encoder.addCertifiedDeviceClass(device_class);
+      } else if (entry.kind == RegulatoryModelEntry::REGULATION) {
+        encoder.addRegulationBitField(entry.regulation_bits);
+      } else {
+        encoder.addEntry(entry.auth_body, entry.struc_type, entry.data.data(), entry.data.size());
+      }
+    }
+  }
+
+  bool decodesTo(const uint8_t* data, size_t length, const std::vector<RegulatoryModelEntry>& entries) {
+    BTDevInfRegulatoryDecoder decoder(data, length);
+    if (!decoder.isValid() || decoder.getEntryCount() != entries.size()) return false;
+
+    for (uint16_t i = 0; i < entries.size(); i++) {
+      const RegulatoryModelEntry& expected = entries[i];
+      BTDevInfRegulatoryEntry entry;
+      if (!decoder.getEntry(i, entry)) return false;
+
+      if (expected.kind == RegulatoryModelEntry::CONTINUA_VERSION) {
+        BTDevInfContinuaVersion version;
+        if (!BTDevInfRegulatoryDecoder::decodeContinuaVersion(entry, version)) return false;
+        if (version.major_version != expected.major_version || version.minor_version != expected.minor_version) return false;
+        if (version.device_class_count != expected.device_classes.size()) return false;
+        for (uint16_t j = 0; j < version.device_class_count; j++) {
+          if (version.getCertifiedDeviceClass(j) != expected.device_classes[j]) return false;
+        }
+      } else if (expected.kind == RegulatoryModelEntry::REGULATION) {
+        uint16_t regulation_bits;
+        if (!BTDevInfRegulatoryDecoder::decodeRegulationBitField(entry, regulation_bits) || regulation_bits != expected.regulation_bits) return false;
+      } else {
+        if (entry.auth_body != expected.auth_body || entry.struc_type != expected.struc_type) return false;
+        if (entry.length != expected.data.size() || (entry.length > 0 && memcmp(entry.data, expected.data.data(), entry.length) != 0)) return false;
+      }
+    }
+    return true;
+  }
+
+  // Round-trips random lists through the encoder and decoder, then feeds the decoder damaged copies
+  void benchRegulatoryFuzz(int iterations) {
+    std::mt19937 random(20601);
+    size_t round_trips = 0;
+    size_t mismatches = 0;
+    size_t overflows = 0;
+    size_t overflows_missed = 0;
+    size_t codec_allocations = 0;
+    size_t mutations = 0;
+    size_t mutations_rejected = 0;
+    size_t mutations_out_of_bounds = 0;
+    double codec_ns = 0;
+
+    for (int i = 0; i < iterations; i++) {
+      std::vector<RegulatoryModelEntry> entries = randomRegulatoryList(random);
+      size_t expected_length = encodedRegulatoryLength(entries);
+
+      BTDevInfRegulatoryList<BLE_ATT_ATTR_MAX_LEN> list;
+      HeapUsage start_heap = heapUsage();
+      auto start = std::chrono::steady_clock::now();
+      encodeRegulatoryList(entries, list);
+      bool decoded = !list.hasFailed() && decodesTo(list.getData(), list.getLength(), entries);
+      codec_ns += nanosecondsSince(start);
+      codec_allocations += heapUsageSince(start_heap).allocations;
+
+      if (expected_length > BLE_ATT_ATTR_MAX_LEN) {
+        overflows++;
+        if (!list.hasFailed() || list.getLength() != 0) overflows_missed++;
+        continue;
+      }
+      if (!decoded || list.getLength() != expected_length) {
+        mismatches++;
+        continue;
+      }
+      round_trips++;
+
+      // A flipped octet or a truncation must never lead the decoder outside the data
+      std::vector<uint8_t> damaged(list.getData(), list.getData() + list.getLength());
+      if (random() % 2) {
+        damaged[random() % damaged.size()] ^= 1 << (random() % 8);
+      } else {
+        damaged.resize(random() % damaged.size());
+      }
+      mutations++;
+
+      BTDevInfRegulatoryDecoder decoder(damaged.data(), damaged.size());
+      if (!decoder.isValid()) {
+        mutations_rejected++;
+        continue;
+      }
+      for (uint16_t j = 0; j < decoder.getEntryCount(); j++) {
+        BTDevInfRegulatoryEntry entry;
+        BTDevInfContinuaVersion version;
+        if (!decoder.getEntry(j, entry) || entry.data + entry.length > damaged.data() + damaged.size()) {
+          mutations_out_of_bounds++;
+          break;
+        }
+        if (BTDevInfRegulatoryDecoder::decodeContinuaVersion(entry, version)
+          && version.device_classes + 2 * version.device_class_count > entry.data + entry.length) {
+          mutations_out_of_bounds++;
+          break;
+        }
+      }
+    }
+
+    // A typical list: Continua 1.0 certified for two device classes, regulated device
+    BTDevInfRegulatoryList<32> typical;
+    typical.addContinuaVersion(1, 0);
+    typical.addCertifiedDeviceClass(0x0004);
+    typical.addCertifiedDeviceClass(0x1007);
+    typical.addRegulationBitField(0);
+
+    printf("{\"benchmark\":\"regulatory_fuzz\",\"iterations\":%d,\"round_trips\":%zu,\"mismatches\":%zu,\"overflows\":%zu,\"overflows_missed\":%zu,"
+      "\"codec_ns_per_list\":%.1f,\"codec_allocations\":%zu,\"mutations\":%zu,\"mutations_rejected\":%zu,\"mutations_out_of_bounds\":%zu,\"typical_octets\":%zu}\n",
+      iterations, round_trips, mismatches, overflows, overflows_missed, codec_ns / iterations, codec_allocations,
+      mutations, mutations_rejected, mutations_out_of_bounds, typical.getLength());
+  }
+
+  void benchDescriptorPolicies() {
+    struct Policy {
+      const char* name;
+      BTDevInfDescriptorPolicy policy;
+    };
+    const Policy policies[] = {
+      {"full", BTDevInfDescriptorPolicy::FULL},
+      {"presentation_format_only", BTDevInfDescriptorPolicy::PRESENTATION_FORMAT_ONLY},
+      {"none", BTDevInfDescriptorPolicy::NONE}
+    };
+    const uint16_t mtus[] = {23, 185, 247};
+
+    for (const Policy& policy : policies) {
+      for (uint16_t mtu : mtus) {
+        NimBLEDevice::init("BTDevInf Bench");
+        NimBLEServer* server = NimBLEDevice::createServer();
+        size_t start_live = heap_live_bytes;
+        uint16_t reported_handles;
+        {
+          BTDevInf device_info(server);
+          device_info.setDescriptorPolicy(policy.policy);
+          applyAllDeviceInfo(device_info);
+          device_info.startService();
+          reported_handles = device_info.getAttributeCount();
+        }
+        size_t heap_bytes = heap_live_bytes - start_live;
+        server->start();
+        NimBLEStandIn::DiscoveryCost cost = NimBLEStandIn::discover(server, NimBLEUUID(DEVICE_INFORMATION_SERVICE_UUID), mtu);
+
+        printf("{\"benchmark\":\"descriptor_policy\",\"policy\":\"%s\",\"mtu\":%u,\"attribute_handles\":%u,\"reported_attribute_handles\":%u,\"heap_bytes\":%zu,"
+          "\"service_requests\":%u,\"characteristic_requests\":%u,\"descriptor_requests\":%u,\"discovery_round_trips\":%u,\"descriptor_reads\":%u}\n",
+          policy.name, mtu, cost.attribute_handles, reported_handles, heap_bytes,
+          cost.service_requests, cost.characteristic_requests, cost.descriptor_requests,
+          cost.service_requests + cost.characteristic_requests + cost.descriptor_requests, cost.descriptor_reads);
+
+        NimBLEDevice::deinit(true);
+      }
+    }
+  }
+
+  // A production-length UDI, used next to the short example values
+  const char LONG_UDI[] = "(01)00643169007222(17)260128(10)A213B1(21)1234567890ABCDEF";
+
+  void benchStaticValues() {
+    // A production-length regulatory list next to the short example values
+    static uint8_t long_ieee_data[96];
+    for (size_t i = 0; i < sizeof(long_ieee_data); i++) long_ieee_data[i] = i;
+
+    struct Profile {
+      const char* name;
+      bool long_values;
+    };
+    const Profile profiles[] = {{"all_device_info", false}, {"long_values", true}};
+    const char* modes[] = {"copy", "static"};
+
+    for (const Profile& profile : profiles) {
+      for (int mode = 0; mode < 2; mode++) {
+        NimBLEDevice::init("BTDevInf Bench");
+        size_t start_live = heap_live_bytes;
+        {
+          BTDevInf device_info(NimBLEDevice::createServer());
+          if (mode == 0) {
+            applyAllDeviceInfo(device_info);
+            if (profile.long_values) {
+              device_info.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(LONG_UDI), sizeof(LONG_UDI) - 1);
+              device_info.setIEEERegulatoryCertificationDataList(long_ieee_data, sizeof(long_ieee_data));
+            }
+          } else {
+            if (profile.long_values) {
+              device_info.setStaticValue(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES, LONG_UDI);
+              device_info.setStaticValue(BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST, long_ieee_data, sizeof(long_ieee_data));
+            }
+            applyAllDeviceInfoStatic(device_info, profile.long_values);
+          }
+          device_info.startService();
+          size_t built_live = heap_live_bytes - start_live;
+          size_t received = readAll(device_info);
+          size_t read_live = heap_live_bytes - start_live;
+
+          printf("{\"benchmark\":\"value_storage\",\"profile\":\"%s\",\"mode\":\"%s\",\"heap_bytes_after_build\":%zu,\"heap_bytes_after_reading_all\":%zu,\"octets_read\":%zu}\n",
+            profile.name, modes[mode], built_live, read_live, received);
+        }
+        NimBLEDevice::deinit(true);
+      }
+    }
+  }
+
+  void benchLongValues() {
+    uint8_t long_ieee_data[96];
+    for (size_t i = 0; i < sizeof(long_ieee_data); i++) long_ieee_data[i] = i;
+
+    const uint16_t mtus[] = {23, 65, 185, 247, 517};
+    const char* profiles[] = {"all_device_info", "long_values"};
+
+    for (int profile = 0; profile < 2; profile++) {
+      NimBLEDevice::init("BTDevInf Bench");
+      NimBLEServer* server = NimBLEDevice::createServer();
+      BTDevInf device_info(server);
+      applyAllDeviceInfo(device_info);
+      if (profile == 1) {
+        device_info.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(LONG_UDI), sizeof(LONG_UDI) - 1);
+        device_info.setIEEERegulatoryCertificationDataList(long_ieee_data, sizeof(long_ieee_data));
+      }
+      device_info.startService();
+      server->start();
+
+      // What BTDevInf predicts against what a client reading every value with Read and Read Blob requests spends
+      for (uint16_t mtu : mtus) {
+        NimBLEConnInfo conn_info(1, mtu, true, true);
+        std::vector<uint8_t> value;
+        unsigned measured = 0;
+        unsigned characteristics = 0;
+        unsigned most = 0;
+        unsigned mismatches = 0;
+        for (size_t i = 0; i < BTDEVINF_CHARACTERISTIC_COUNT; i++) {
+          BTDevInfCharacteristic characteristic = static_cast<BTDevInfCharacteristic>(i);
+          if (device_info.getCharacteristic(characteristic) == nullptr) continue;
+          uint16_t round_trips = 0;
+          NimBLEStandIn::readLong(device_info.getCharacteristic(characteristic), conn_info, value, &round_trips);
+          if (round_trips != device_info.getReadRoundTrips(characteristic, mtu)) mismatches++;
+          if (round_trips > most) most = round_trips;
+          measured += round_trips;
+          characteristics++;
+        }
+
+        printf("{\"benchmark\":\"long_values\",\"profile\":\"%s\",\"mtu\":%u,\"reported_round_trips\":%u,\"measured_round_trips\":%u,\"read_blob_requests\":%u,"
+          "\"most_round_trips_per_value\":%u,\"mismatches\":%u}\n",
+          profiles[profile], mtu, device_info.getReadRoundTrips(mtu), measured, measured - characteristics, most, mismatches);
+      }
+
+      NimBLEDevice::deinit(true);
+    }
+  }
+
+  // Every UDI set by benchLongValueUpdates() is one letter repeated, so a read that mixes two of them is detectable
+  void fillUDI(uint8_t* udi, size_t length, int sequence) {
+    memset(udi, 'A' + sequence % 26, length);
+  }
+
+  void benchLongValueUpdates() {
+    const size_t UDI_LENGTH = sizeof(LONG_UDI) - 1;
+    const int SEQUENCES = 100;
+    const char* modes[] = {"plain", "stable", "stable_two_connections"};
+
+    for (int mode = 0; mode < 3; mode++) {
+      NimBLEDevice::init("BTDevInf Bench");
+      NimBLEServer* server = NimBLEDevice::createServer();
+      BTDevInf device_info(server);
+      applyAllDeviceInfo(device_info);
+
+      uint8_t udi[UDI_LENGTH];
+      fillUDI(udi, UDI_LENGTH, 0);
+      size_t start_live = heap_live_bytes;
+      bool stable = mode >= 1 && device_info.enableStableLongReads();
+      device_info.setUDIForMedicalDevices(udi, UDI_LENGTH);
+      size_t heap_bytes = heap_live_bytes - start_live;
+      device_info.startService();
+      server->start();
+
+      // Each read sequence has the value set again right after each Read, before the Read Blob requests. With two
+      // connections, both Reads come first and their Read Blob requests take turns, as two clients reading at once
+      NimBLEConnInfo connections[2] = {NimBLEConnInfo(1, 23, true, true), NimBLEConnInfo(2, 23, true, true)};
+      const NimBLEConnInfo& conn_info = connections[0];
+      size_t connection_count = mode == 2 ? 2 : 1;
+      NimBLECharacteristic* characteristic = device_info.getUDIForMedicalDevicesCharacteristic();
+      unsigned torn_reads = 0;
+      unsigned stale_reads = 0;
+      unsigned requests = 0;
+      int version = 0;
+      for (int sequence = 0; sequence < SEQUENCES; sequence++) {
+        std::vector<uint8_t> values[2];
+        bool done[2] = {false, false};
+        std::vector<uint8_t> response;
+        for (size_t finished = 0; finished < connection_count;) {
+          for (size_t c = 0; c < connection_count; c++) {
+            if (done[c]) continue;
+            NimBLEStandIn::read(characteristic, connections[c], values[c].size(), response);
+            values[c].insert(values[c].end(), response.begin(), response.end());
+            requests++;
+            if (values[c].size() == response.size()) {
+              fillUDI(udi, UDI_LENGTH, ++version);
+              device_info.setUDIForMedicalDevices(udi, UDI_LENGTH);
+            }
+            if (response.size() < static_cast<size_t>(connections[c].getMTU() - 1)) {
+              done[c] = true;
+              finished++;
+            }
+          }
+        }
+
+        // The reads started after the value for this sequence was set, so they must have all of it; a second
+        // connection shares the copy made for the first
+        for (size_t c = 0; c < connection_count; c++) {
+          const std::vector<uint8_t>& value = values[c];
+          if (value.size() != UDI_LENGTH || std::count(value.begin(), value.end(), value[0]) != static_cast<long>(UDI_LENGTH)) {
+            torn_reads++;
+          } else if (value[0] != 'A' + (version - static_cast<int>(connection_count)) % 26) {
+            stale_reads++;
+          }
+          device_info.onDisconnect(connections[c]);
+        }
+      }
+
+      // Values no characteristic can hold are rejected, and logged on stderr since the host build defines BTDEVINF_WARN_LONG_VALUES
+      uint8_t oversized[BLE_ATT_ATTR_MAX_LEN + 1] = {};
+      bool oversized_rejected = !device_info.setUDIForMedicalDevices(oversized, sizeof(oversized));
+
+      printf("{\"benchmark\":\"long_value_updates\",\"mode\":\"%s\",\"stable_long_reads\":%s,\"mtu\":%u,\"value_octets\":%zu,\"read_sequences\":%d,\"att_requests\":%u,"
+        "\"torn_reads\":%u,\"stale_reads\":%u,\"heap_bytes\":%zu,\"oversized_rejected\":%s}\n",
+        modes[mode], stable ? "true" : "false", conn_info.getMTU(), UDI_LENGTH, SEQUENCES * static_cast<int>(connection_count), requests,
+        torn_reads, stale_reads, heap_bytes, oversized_rejected ? "true" : "false");
+
+      NimBLEDevice::deinit(true);
+    }
+  }
+
+  // Handles, types and properties of every attribute of the service, as a client's GATT cache holds them
+  std::string handleLayout(NimBLEService* service) {
+    std::string layout;
+    auto put16 = [&layout](uint16_t value) {
+      layout.push_back(static_cast<char>(value & 0xFF));
+      layout.push_back(static_cast<char>(value >> 8));
+    };
+    auto putUUID = [&layout](const NimBLEUUID& uuid) {
+      layout.append(reinterpret_cast<const char*>(uuid.getValue()), uuid.bitSize() / 8);
+    };
+
+    put16(service->getHandle());
+    put16(service->getEndHandle());
+    for (const NimBLECharacteristic* characteristic : service->getCharacteristics()) {
+      put16(characteristic->getHandle());
+      put16(characteristic->getProperties());
+      putUUID(characteristic->getUUID());
+      for (const NimBLEDescriptor* descriptor : characteristic->getDescriptors()) {
+        put16(descriptor->getHandle());
+        putUUID(descriptor->getUUID());
+      }
+    }
+    return layout;
+  }
+
+  struct LayoutResult {
+    std::string layout;
+    uint32_t hash;
+  };
+
+  // Builds a device with the setters in the given order and registers its handles
+  LayoutResult buildLayout(const int* order, size_t count, bool canonical, uint16_t characteristics = BTDEVINF_ALL_CHARACTERISTICS,
+      BTDevInfDescriptorPolicy policy = BTDevInfDescriptorPolicy::FULL, bool preceding_service = false) {
+    NimBLEServer server;
+    if (preceding_service) server.createService(NimBLEUUID(static_cast<uint16_t>(0x180F)))->start();
+    BTDevInf device_info(&server);
+    device_info.setDescriptorPolicy(policy);
+    if (canonical) device_info.enableCanonicalLayout(characteristics);
+    for (size_t i = 0; i < count; i++) {
+      SETTERS[order[i]].call(device_info);
+    }
+    device_info.startService();
+    server.start();
+    return {handleLayout(device_info.getService()), device_info.getLayoutHash()};
+  }
+
+  void benchHandleLayout() {
+    constexpr size_t SETTER_COUNT = sizeof(SETTERS) / sizeof(SETTERS[0]);
+    int order[SETTER_COUNT];
+    for (size_t i = 0; i < SETTER_COUNT; i++) {
+      order[i] = static_cast<int>(i);
+    }
+    LayoutResult reference = buildLayout(order, SETTER_COUNT, true);
+
+    // Every order of the first eight setters, then the last two
+    std::vector<std::string> layouts;
+    std::vector<std::string> unordered_layouts;
+    std::vector<uint32_t> hashes;
+    size_t permutations = 0;
+    auto start = std::chrono::steady_clock::now();
+    do {
+      LayoutResult result = buildLayout(order, SETTER_COUNT, true);
+      layouts.push_back(result.layout);
+      hashes.push_back(result.hash);
+      unordered_layouts.push_back(buildLayout(order, SETTER_COUNT, false).layout);
+      permutations++;
+    } while (std::next_permutation(order, order + 8));
+    double ns = nanosecondsSince(start);
+
+    // Random orders of random subsets; the setters left out stay reserved
+    std::mt19937 random(2803);
+    size_t subsets = 0;
+    size_t subset_mismatches = 0;
+    for (int trial = 0; trial < 2000; trial++) {
+      std::shuffle(order, order + SETTER_COUNT, random);
+      size_t count = random() % (SETTER_COUNT + 1);
+      LayoutResult result = buildLayout(order, count, true);
+      if (result.layout != reference.layout || result.hash != reference.hash) subset_mismatches++;
+      subsets++;
+    }
+
+    auto distinct = [](auto values) {
+      std::sort(values.begin(), values.end());
+      return static_cast<size_t>(std::unique(values.begin(), values.end()) - values.begin());
+    };
+
+    // Reserved characteristics read as empty, values never change the hash, setters outside the layout fail
+    bool reserved_reads_empty;
+    bool values_keep_hash;
+    bool setter_outside_layout_rejected;
+    {
+      NimBLEServer server;
+      BTDevInf device_info(&server);
+      device_info.enableCanonicalLayout(BTDEVINF_ALL_CHARACTERISTICS & ~btdevinfCharacteristicBit(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES));
+      uint32_t empty_hash = device_info.getLayoutHash();
+      device_info.startService();
+      server.start();
+      std::vector<uint8_t> value;
+      NimBLEConnInfo conn_info(1, 23, true, true);
+      NimBLEStandIn::readLong(device_info.getSerialNumberStringCharacteristic(), conn_info, value);
+      reserved_reads_empty = value.empty();
+      device_info.setSerialNumberString("SN123456789");
+      device_info.setSerialNumberString("SN987654321-REV2");
+      values_keep_hash = device_info.getLayoutHash() == empty_hash;
+      setter_outside_layout_rejected = !device_info.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(UDI), sizeof(UDI) - 1) &&
+        device_info.getUDIForMedicalDevicesCharacteristic() == nullptr;
+    }
+    // Descriptors change the hash; services registered before this one move its handles but not its hash
+    LayoutResult other_policy = buildLayout(order, SETTER_COUNT, true, BTDEVINF_ALL_CHARACTERISTICS, BTDevInfDescriptorPolicy::PRESENTATION_FORMAT_ONLY);
+    LayoutResult after_service = buildLayout(order, SETTER_COUNT, true, BTDEVINF_ALL_CHARACTERISTICS, BTDevInfDescriptorPolicy::FULL, true);
+
+    printf("{\"benchmark\":\"handle_layout\",\"permutations\":%zu,\"ns_per_build\":%.1f,\"distinct_layouts\":%zu,\"distinct_hashes\":%zu,\"distinct_layouts_without_canonical\":%zu,"
+      "\"subsets\":%zu,\"subset_mismatches\":%zu,\"layout_hash\":\"%08x\",\"reserved_reads_empty\":%s,\"values_keep_hash\":%s,\"setter_outside_layout_rejected\":%s,"
+      "\"descriptor_policy_changes_hash\":%s,\"preceding_service_keeps_hash\":%s,\"preceding_service_moves_handles\":%s}\n",
+      permutations, ns / (2 * permutations), distinct(layouts), distinct(hashes), distinct(unordered_layouts),
+      subsets, subset_mismatches, reference.hash, reserved_reads_empty ? "true" : "false", values_keep_hash ? "true" : "false",
+      setter_outside_layout_rejected ? "true" : "false", other_policy.hash != reference.hash ? "true" : "false",
+      after_service.hash == reference.hash ? "true" : "false", after_service.layout != reference.layout ? "true" : "false");
+  }
+}
+
+void* operator new(size_t size) {
+  heap_allocations++;
+  heap_bytes += size;
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) throw std::bad_alloc();
+  heap_live_bytes += malloc_usable_size(pointer);
+  return pointer;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  if (pointer == nullptr) return;
+  heap_live_bytes -= malloc_usable_size(pointer);
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  operator delete(pointer);
+}
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+  if (iterations <= 0) iterations = 1000;
+
+  printf("{\"benchmark\":\"meta\",\"sizeof_btdevinf\":%zu,\"static_init_uuid_constructions\":%u}\n",
+    sizeof(BTDevInf), NimBLEStandIn::counters().uuid_constructions);
+
+  benchConstructor(iterations);
+  benchSetters(iterations);
+  benchAllDeviceInfoProfile(iterations);
+  benchBuilder(iterations);
+  benchDescriptorPolicies();
+  benchStaticValues();
+  benchValueProviders();
+  benchInstrumentation(iterations);
+  benchClient();
+  benchClientCache(200);
+  benchAdvertising();
+  benchConcurrentUpdates(250);
+  benchSnapshot(iterations);
+  benchStaticProfile(iterations);
+  benchRegulatoryFuzz(iterations * 20);
+  benchLongValues();
+  benchLongValueUpdates();
+  benchSetterAllocations(iterations * 10);
+  benchHandleLayout();
+
+  return 0;
+}
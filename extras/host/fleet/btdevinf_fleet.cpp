@@ -0,0 +1,229 @@
+/**
+ * @brief Fleet simulator: many virtual peripherals, each with its own server and BTDevInf, in one process
+ * @note Every device is built from one template plus its own serial number and System ID, once with copied values and once with the template values interned in a shared BTDevInfValuePool.
+ *       Prints one JSON object per fleet size and mode, with the heap each device holds once built and once a client has read every value, and how fast devices are built.
+ * @note Usage: btdevinf_fleet [max_devices]
+ */
+
+#include <BTDevInf.h>
+#include <BTDevInfRegulatory.h>
+#include <BTDevInfValuePool.h>
+
+#include <malloc.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+  size_t heap_allocations = 0;
+  size_t heap_live_bytes = 0;
+
+  /**
+   * @brief What every device of the fleet has in common
+   */
+  struct DeviceTemplate {
+    const char* manufacturer_name;
+    const char* model_number;
+    const char* firmware_revision;
+    const char* hardware_revision;
+    const char* software_revision;
+    uint8_t pnp_id[7];   // In its characteristic layout
+    uint8_t oui[3];      // Upper 24 bits of every System ID, least significant first
+    const char* serial_prefix;
+  };
+
+  const DeviceTemplate FLEET_TEMPLATE = {
+    "Example Medical Devices Incorporated",
+    "EX-1000 Continuous Glucose Monitor",
+    "2.4.1-release+build.20261016",
+    "Rev C / PCB 1000-0042",
+    "EX-1000 Sensor Stack 2.4.1",
+    {0x02, 0x3A, 0x30, 0x01, 0x10, 0x00, 0x01},
+    {0x5E, 0x2A, 0x00},
+    "EX1-"
+  };
+
+  struct Device {
+    NimBLEServer* server;
+    BTDevInf* device_info;
+  };
+
+  void formatSerial(char (&serial)[24], const DeviceTemplate& device_template, size_t index) {
+    snprintf(serial, sizeof(serial), "%s%08zu", device_template.serial_prefix, index);
+  }
+
+  // Manufacturer-defined identifier (40 bits) then OUI (24 bits), least significant octet first
+  void formatSystemID(uint8_t (&system_id)[8], const DeviceTemplate& device_template, size_t index) {
+    for (int i = 0; i < 5; i++) {
+      system_id[i] = (static_cast<uint64_t>(index) >> (8 * i)) & 0xFF;
+    }
+    memcpy(system_id + 5, device_template.oui, 3);
+  }
+
+  void buildDevice(Device& device, const DeviceTemplate& device_template, const uint8_t* regulatory, size_t regulatory_length, size_t index, BTDevInfValuePool* pool) {
+    device.server = new NimBLEServer();
+    device.device_info = new BTDevInf(device.server);
+    BTDevInf& device_info = *device.device_info;
+
+    char serial[24];
+    uint8_t system_id[8];
+    formatSerial(serial, device_template, index);
+    formatSystemID(system_id, device_template, index);
+    device_info.setSerialNumberString(serial);
+    device_info.setSystemID(system_id, sizeof(system_id));
+
+    if (pool == nullptr) {
+      device_info.setManufacturerNameString(device_template.manufacturer_name);
+      device_info.setModelNumberString(device_template.model_number);
+      device_info.setFirmwareRevisionString(device_template.firmware_revision);
+      device_info.setHardwareRevisionString(device_template.hardware_revision);
+      device_info.setSoftwareRevisionString(device_template.software_revision);
+      device_info.setValue(BTDevInfCharacteristic::PNP_ID, device_template.pnp_id, sizeof(device_template.pnp_id));
+      device_info.setIEEERegulatoryCertificationDataList(regulatory, regulatory_length);
+    } else {
+      device_info.setPooledValue(BTDevInfCharacteristic::MANUFACTURER_NAME_STRING, *pool, device_template.manufacturer_name);
+      device_info.setPooledValue(BTDevInfCharacteristic::MODEL_NUMBER_STRING, *pool, device_template.model_number);
+      device_info.setPooledValue(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, *pool, device_template.firmware_revision);
+      device_info.setPooledValue(BTDevInfCharacteristic::HARDWARE_REVISION_STRING, *pool, device_template.hardware_revision);
+      device_info.setPooledValue(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, *pool, device_template.software_revision);
+      device_info.setPooledValue(BTDevInfCharacteristic::PNP_ID, *pool, device_template.pnp_id, sizeof(device_template.pnp_id));
+      device_info.setPooledValue(BTDevInfCharacteristic::IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST, *pool, regulatory, regulatory_length);
+    }
+
+    device_info.startService();
+    device.server->start();
+  }
+
+  // Reads every value of a device once, as a client that just connected would
+  void readDevice(Device& device) {
+    NimBLEConnInfo conn_info(1, 23, true, true);
+    std::vector<uint8_t> value;
+    for (size_t c = 0; c < BTDEVINF_CHARACTERISTIC_COUNT; c++) {
+      NimBLECharacteristic* characteristic = device.device_info->getCharacteristic(static_cast<BTDevInfCharacteristic>(c));
+      if (characteristic != nullptr) NimBLEStandIn::readLong(characteristic, conn_info, value);
+    }
+  }
+
+  // Reads a device's values as a client would and compares them with what it was built from
+  bool verifyDevice(Device& device, const DeviceTemplate& device_template, size_t index) {
+    NimBLEConnInfo conn_info(1, 23, true, true);
+    std::vector<uint8_t> value;
+    char serial[24];
+    uint8_t system_id[8];
+    formatSerial(serial, device_template, index);
+    formatSystemID(system_id, device_template, index);
+
+    NimBLEStandIn::readLong(device.device_info->getSerialNumberStringCharacteristic(), conn_info, value);
+    if (std::string(value.begin(), value.end()) != serial) return false;
+    NimBLEStandIn::readLong(device.device_info->getSystemIDCharacteristic(), conn_info, value);
+    if (value.size() != sizeof(system_id) || memcmp(value.data(), system_id, sizeof(system_id)) != 0) return false;
+    NimBLEStandIn::readLong(device.device_info->getManufacturerNameStringCharacteristic(), conn_info, value);
+    if (std::string(value.begin(), value.end()) != device_template.manufacturer_name) return false;
+    NimBLEStandIn::readLong(device.device_info->getPnPIDCharacteristic(), conn_info, value);
+    return value.size() == sizeof(device_template.pnp_id) && memcmp(value.data(), device_template.pnp_id, sizeof(device_template.pnp_id)) == 0;
+  }
+
+  void simulateFleet(size_t device_count, bool pooled) {
+    BTDevInfRegulatoryList<64> regulatory;
+    regulatory.addContinuaVersion(1, 0);
+    regulatory.addCertifiedDeviceClass(0x1007);
+    regulatory.addCertifiedDeviceClass(0x1029);
+    regulatory.addRegulationBitField(0x0000);
+
+    std::vector<Device> devices(device_count);
+    size_t start_live = heap_live_bytes;
+    size_t start_allocations = heap_allocations;
+    NimBLEStandIn::resetCounters();
+    auto start = std::chrono::steady_clock::now();
+    BTDevInfValuePool* pool = pooled ? new BTDevInfValuePool() : nullptr;
+    for (size_t i = 0; i < device_count; i++) {
+      buildDevice(devices[i], FLEET_TEMPLATE, regulatory.getData(), regulatory.getLength(), i, pool);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t fleet_bytes = heap_live_bytes - start_live;
+    size_t fleet_allocations = heap_allocations - start_allocations;
+    size_t value_buffer_bytes = NimBLEStandIn::counters().value_bytes_allocated;
+
+    // Reads copy pooled values into each characteristic, since NimBLE serves every request from the characteristic's own value
+    for (Device& device : devices) {
+      readDevice(device);
+    }
+    size_t read_fleet_bytes = heap_live_bytes - start_live;
+    size_t read_value_buffer_bytes = NimBLEStandIn::counters().value_bytes_allocated;
+
+    // Spot-check the first, middle and last devices
+    bool verified = true;
+    for (size_t index : {size_t(0), device_count / 2, device_count - 1}) {
+      verified = verified && verifyDevice(devices[index], FLEET_TEMPLATE, index);
+    }
+    size_t pool_values = pool != nullptr ? pool->getValueCount() : 0;
+    size_t pool_bytes = pool != nullptr ? pool->getValueBytes() : 0;
+    uint32_t references = pool != nullptr ? pool->getReferenceCount(reinterpret_cast<const uint8_t*>(FLEET_TEMPLATE.model_number), strlen(FLEET_TEMPLATE.model_number)) : 0;
+
+    // Tearing the fleet down gives back everything it held, pool values included
+    for (Device& device : devices) {
+      delete device.device_info;
+      delete device.server;
+    }
+    size_t pool_values_after = pool != nullptr ? pool->getValueCount() : 0;
+    delete pool;
+    size_t leaked_bytes = heap_live_bytes - start_live;
+
+    printf("{\"benchmark\":\"fleet\",\"mode\":\"%s\",\"devices\":%zu,\"heap_bytes_per_device\":%.1f,\"allocations_per_device\":%.1f,\"value_buffer_bytes_per_device\":%.1f,"
+      "\"heap_bytes_per_device_after_reads\":%.1f,\"value_buffer_bytes_per_device_after_reads\":%.1f,\"ns_per_device\":%.1f,\"devices_per_second\":%.0f,\"pool_values\":%zu,\"pool_bytes\":%zu,\"model_number_references\":%u,"
+      "\"verified\":%s,\"pool_values_after_teardown\":%zu,\"leaked_bytes\":%zu}\n",
+      pooled ? "pooled" : "copy", device_count, double(fleet_bytes) / device_count, double(fleet_allocations) / device_count, double(value_buffer_bytes) / device_count,
+      double(read_fleet_bytes) / device_count, double(read_value_buffer_bytes) / device_count,
+      seconds * 1e9 / device_count, device_count / seconds, pool_values, pool_bytes, references,
+      verified ? "true" : "false", pool_values_after, leaked_bytes);
+  }
+}
+
+void* operator new(size_t size) {
+  heap_allocations++;
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) throw std::bad_alloc();
+  heap_live_bytes += malloc_usable_size(pointer);
+  return pointer;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  if (pointer == nullptr) return;
+  heap_live_bytes -= malloc_usable_size(pointer);
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  operator delete(pointer);
+}
+
+int main(int argc, char** argv) {
+  long max_devices = argc > 1 ? atol(argv[1]) : 10000;
+  if (max_devices <= 0) max_devices = 10000;
+
+  printf("{\"benchmark\":\"fleet_meta\",\"sizeof_btdevinf\":%zu,\"sizeof_nimble_server\":%zu}\n", sizeof(BTDevInf), sizeof(NimBLEServer));
+
+  for (size_t device_count = 10; device_count <= static_cast<size_t>(max_devices); device_count *= 10) {
+    simulateFleet(device_count, false);
+    simulateFleet(device_count, true);
+  }
+
+  return 0;
+}
@@ -0,0 +1,21 @@
+/**
+ * @brief A four-characteristic profile built with BTDevInf, for comparing binary size with size_static.cpp
+ * @note Build and compare both with the size target of the host build.
+ */
+
+#include <BTDevInf.h>
+
+#include <cstdio>
+
+int main() {
+  NimBLEDevice::init("BTDevInf Size");
+  BTDevInf device_info(NimBLEDevice::createServer());
+  device_info.setModelNumberString("EX-1000");
+  device_info.setFirmwareRevisionString("1.0.0");
+  device_info.setManufacturerNameString("Example Corp");
+  device_info.setPnPID(0x02, 0x303A, 0x1001, 0x0100);
+  device_info.startService();
+
+  printf("%u\n", device_info.getAttributeCount());
+  return 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * @brief The profile of size_runtime.cpp built with BTDevInfStatic
+ * @note Build and compare both with the size target of the host build.
+ */
+
+#include <BTDevInfStatic.h>
+
+#include <cstdio>
+
+int main() {
+  NimBLEDevice::init("BTDevInf Size");
+  BTDevInfStatic<BTDevInfCharacteristic::MODEL_NUMBER_STRING, BTDevInfCharacteristic::FIRMWARE_REVISION_STRING,
+    BTDevInfCharacteristic::MANUFACTURER_NAME_STRING, BTDevInfCharacteristic::PNP_ID> device_info(NimBLEDevice::createServer());
+  device_info.setModelNumberString("EX-1000");
+  device_info.setFirmwareRevisionString("1.0.0");
+  device_info.setManufacturerNameString("Example Corp");
+  device_info.setPnPID(0x02, 0x303A, 0x1001, 0x0100);
+  device_info.startService();
+
+  printf("%u\n", device_info.getAttributeCount());
+  return 0;
+}
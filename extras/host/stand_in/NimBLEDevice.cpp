@@ -0,0 +1,764 @@
+#include "NimBLEDevice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace {
+  NimBLEServer* device_server = nullptr;
+  std::vector<NimBLEClient*> device_clients;
+  NimBLEAdvertising* device_advertising = nullptr;
+  NimBLEStandIn::Counters stand_in_counters = {};
+
+  // Bluetooth Base UUID 00000000-0000-1000-8000-00805F9B34FB, little endian as NimBLE stores it
+  const uint8_t BASE_UUID[16] = {0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+  int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+}
+
+ble_npl_time_t ble_npl_time_get(void) {
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t ble_npl_time_ticks_to_ms32(ble_npl_time_t ticks) {
+  return ticks;
+}
+
+void ble_npl_time_delay(ble_npl_time_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+NimBLEStandIn::Counters& NimBLEStandIn::counters() {
+  return stand_in_counters;
+}
+
+void NimBLEStandIn::resetCounters() {
+  stand_in_counters = {};
+}
+
+int NimBLEStandIn::read(NimBLECharacteristic* characteristic, NimBLEConnInfo& conn_info, uint16_t offset, std::vector<uint8_t>& response) {
+  response.clear();
+  if (characteristic == nullptr) return BLE_ATT_ERR_INVALID_HANDLE;
+
+  uint16_t properties = characteristic->getProperties();
+  if (!(properties & NIMBLE_PROPERTY::READ)) return BLE_ATT_ERR_READ_NOT_PERMITTED;
+  if ((properties & NIMBLE_PROPERTY::READ_AUTHEN) && !conn_info.isAuthenticated()) return BLE_ATT_ERR_INSUFFICIENT_AUTHEN;
+  if ((properties & NIMBLE_PROPERTY::READ_ENC) && !conn_info.isEncrypted()) return BLE_ATT_ERR_INSUFFICIENT_ENC;
+
+  if (offset == 0 && characteristic->getCallbacks() != nullptr) {
+    characteristic->getCallbacks()->onRead(characteristic, conn_info);
+  }
+
+  const NimBLEAttValue& value = characteristic->getAttVal();
+  if (offset > value.size()) return BLE_ATT_ERR_INVALID_OFFSET;
+
+  size_t length = std::min<size_t>(value.size() - offset, conn_info.getMTU() - 1);
+  response.assign(value.data() + offset, value.data() + offset + length);
+  return 0;
+}
+
+int NimBLEStandIn::readLong(NimBLECharacteristic* characteristic, NimBLEConnInfo& conn_info, std::vector<uint8_t>& value, uint16_t* round_trips) {
+  value.clear();
+  std::vector<uint8_t> response;
+  uint16_t requests = 0;
+  int rc;
+
+  do {
+    rc = read(characteristic, conn_info, value.size(), response);
+    requests++;
+    if (rc != 0) break;
+    value.insert(value.end(), response.begin(), response.end());
+  } while (response.size() == static_cast<size_t>(conn_info.getMTU() - 1));
+
+  if (round_trips != nullptr) *round_trips = requests;
+  return rc;
+}
+
+NimBLEStandIn::DiscoveryCost NimBLEStandIn::discover(NimBLEServer* server, const NimBLEUUID& service_uuid, uint16_t mtu) {
+  DiscoveryCost cost = {};
+
+  // Each 16-bit entry is a handle range (4 octets), a characteristic declaration (7 octets) or a handle and UUID pair (4 octets)
+  const size_t ranges_per_response = (mtu - 1) / 4;
+  const size_t declarations_per_response = (mtu - 2) / 7;
+  const size_t descriptors_per_response = (mtu - 2) / 4;
+
+  size_t matching_services = 0;
+  for (NimBLEService* service : server->getServices()) {
+    if (service->getUUID() == service_uuid && service->getHandle() != 0) matching_services++;
+  }
+  cost.service_requests = (matching_services + ranges_per_response - 1) / ranges_per_response + 1;
+
+  NimBLEService* service = server->getServiceByUUID(service_uuid);
+  if (service == nullptr || service->getHandle() == 0) return cost;
+
+  cost.attribute_handles = service->getEndHandle() - service->getHandle() + 1;
+
+  const std::vector<NimBLECharacteristic*>& characteristics = service->getCharacteristics();
+  cost.characteristic_requests = (characteristics.size() + declarations_per_response - 1) / declarations_per_response + 1;
+
+  for (NimBLECharacteristic* characteristic : characteristics) {
+    size_t descriptors = characteristic->getDescriptors().size();
+    cost.descriptor_requests += (descriptors + descriptors_per_response - 1) / descriptors_per_response;
+    cost.descriptor_reads += descriptors;
+  }
+
+  return cost;
+}
+
+/**
+ * @brief Peer side of stand-in client connections: serves the client's ATT requests from the connected server
+ */
+class NimBLEStandInPeer {
+  public:
+    static NimBLEClient* findClient(uint16_t conn_handle) {
+      for (NimBLEClient* client : device_clients) {
+        if (client->isConnected() && client->getConnHandle() == conn_handle) return client;
+      }
+      return nullptr;
+    }
+
+    static NimBLEServer* peer(NimBLEClient* client) {
+      return client->peer;
+    }
+
+    static NimBLEConnInfo& connInfo(NimBLEClient* client) {
+      return client->conn_info;
+    }
+
+    static bool readMultipleVariable(NimBLEClient* client) {
+      return client->read_multiple_variable;
+    }
+
+    static NimBLECharacteristic* findCharacteristic(NimBLEServer* server, uint16_t handle) {
+      for (NimBLEService* service : server->getServices()) {
+        if (handle < service->getHandle() || handle > service->getEndHandle()) continue;
+        return service->getCharacteristicByHandle(handle);
+      }
+      return nullptr;
+    }
+};
+
+bool NimBLEStandIn::connect(NimBLEClient* client, NimBLEServer* peer, const NimBLEConnInfo& conn_info, bool read_multiple_variable) {
+  if (client == nullptr || peer == nullptr || !peer->isStarted()) return false;
+
+  client->deleteServices();
+  client->peer = peer;
+  client->conn_info = conn_info;
+  client->read_multiple_variable = read_multiple_variable;
+  return true;
+}
+
+int os_mbuf_copydata(const struct os_mbuf* om, int off, int len, void* dst) {
+  if (off < 0 || len < 0 || static_cast<size_t>(off + len) > om->data.size()) return -1;
+  if (len > 0) memcpy(dst, om->data.data() + off, len);
+  return 0;
+}
+
+bool NimBLEUtils::taskWait(const NimBLETaskData& task_data, uint32_t /*timeout*/) {
+  stand_in_counters.task_waits++;
+  return task_data.released;
+}
+
+void NimBLEUtils::taskRelease(const NimBLETaskData& task_data, int rc) {
+  task_data.m_flags = rc;
+  task_data.released = true;
+}
+
+int ble_gattc_read(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_attr_fn* cb, void* cb_arg) {
+  NimBLEClient* client = NimBLEStandInPeer::findClient(conn_handle);
+  if (client == nullptr) return BLE_HS_ENOTCONN;
+
+  stand_in_counters.att_requests++;
+  NimBLECharacteristic* characteristic = NimBLEStandInPeer::findCharacteristic(NimBLEStandInPeer::peer(client), attr_handle);
+  os_mbuf om;
+  int rc = NimBLEStandIn::read(characteristic, NimBLEStandInPeer::connInfo(client), 0, om.data);
+
+  ble_gatt_error error = {static_cast<uint16_t>(BLE_HS_ATT_ERR(rc)), attr_handle};
+  ble_gatt_attr attr = {attr_handle, 0, &om};
+  if (cb != nullptr) cb(conn_handle, &error, rc == 0 ? &attr : nullptr, cb_arg);
+  return 0;
+}
+
+int ble_gattc_read_long(uint16_t conn_handle, uint16_t handle, uint16_t offset, ble_gatt_attr_fn* cb, void* cb_arg) {
+  NimBLEClient* client = NimBLEStandInPeer::findClient(conn_handle);
+  if (client == nullptr) return BLE_HS_ENOTCONN;
+
+  NimBLECharacteristic* characteristic = NimBLEStandInPeer::findCharacteristic(NimBLEStandInPeer::peer(client), handle);
+  NimBLEConnInfo& conn_info = NimBLEStandInPeer::connInfo(client);
+
+  // Read (offset 0) or Read Blob until a response is shorter than MTU-1, then report BLE_HS_EDONE
+  while (true) {
+    stand_in_counters.att_requests++;
+    os_mbuf om;
+    int rc = NimBLEStandIn::read(characteristic, conn_info, offset, om.data);
+
+    ble_gatt_error error = {static_cast<uint16_t>(BLE_HS_ATT_ERR(rc)), handle};
+    if (rc != 0) {
+      if (cb != nullptr) cb(conn_handle, &error, nullptr, cb_arg);
+      return 0;
+    }
+
+    ble_gatt_attr attr = {handle, offset, &om};
+    if (cb != nullptr && cb(conn_handle, &error, &attr, cb_arg) != 0) return 0;
+
+    offset += om.data.size();
+    if (om.data.size() < static_cast<size_t>(conn_info.getMTU() - 1)) break;
+  }
+
+  ble_gatt_error done = {BLE_HS_EDONE, handle};
+  if (cb != nullptr) cb(conn_handle, &done, nullptr, cb_arg);
+  return 0;
+}
+
+int ble_gattc_read_mult_var(uint16_t conn_handle, const uint16_t* handles, uint8_t num_handles, ble_gatt_attr_mult_fn* cb, void* cb_arg) {
+  NimBLEClient* client = NimBLEStandInPeer::findClient(conn_handle);
+  if (client == nullptr) return BLE_HS_ENOTCONN;
+  if (num_handles < 2) return BLE_HS_EINVAL;
+
+  stand_in_counters.att_requests++;
+  NimBLEServer* peer = NimBLEStandInPeer::peer(client);
+  NimBLEConnInfo& conn_info = NimBLEStandInPeer::connInfo(client);
+
+  if (!NimBLEStandInPeer::readMultipleVariable(client)) {
+    ble_gatt_error error = {BLE_HS_ATT_ERR(BLE_ATT_ERR_REQ_NOT_SUPPORTED), handles[0]};
+    if (cb != nullptr) cb(conn_handle, &error, nullptr, 0, cb_arg);
+    return 0;
+  }
+
+  // The whole request fails with the first attribute that cannot be read
+  std::vector<NimBLECharacteristic*> characteristics;
+  for (uint8_t i = 0; i < num_handles; i++) {
+    NimBLECharacteristic* characteristic = NimBLEStandInPeer::findCharacteristic(peer, handles[i]);
+    uint16_t properties = characteristic != nullptr ? characteristic->getProperties() : 0;
+    int rc = 0;
+    if (characteristic == nullptr) rc = BLE_ATT_ERR_INVALID_HANDLE;
+    else if (!(properties & NIMBLE_PROPERTY::READ)) rc = BLE_ATT_ERR_READ_NOT_PERMITTED;
+    else if ((properties & NIMBLE_PROPERTY::READ_AUTHEN) && !conn_info.isAuthenticated()) rc = BLE_ATT_ERR_INSUFFICIENT_AUTHEN;
+    else if ((properties & NIMBLE_PROPERTY::READ_ENC) && !conn_info.isEncrypted()) rc = BLE_ATT_ERR_INSUFFICIENT_ENC;
+    if (rc != 0) {
+      ble_gatt_error error = {static_cast<uint16_t>(BLE_HS_ATT_ERR(rc)), handles[i]};
+      if (cb != nullptr) cb(conn_handle, &error, nullptr, 0, cb_arg);
+      return 0;
+    }
+    characteristics.push_back(characteristic);
+  }
+
+  // Length and value tuples, cut off at MTU-1 octets; a tuple is reported if its length field fits
+  std::vector<os_mbuf> values(num_handles);
+  std::vector<ble_gatt_attr> attrs;
+  size_t remaining = conn_info.getMTU() - 1;
+  for (uint8_t i = 0; i < num_handles && remaining >= 2; i++) {
+    std::vector<uint8_t> response;
+    NimBLEConnInfo unlimited(conn_info.getConnHandle(), BLE_ATT_ATTR_MAX_LEN + 1, conn_info.isEncrypted(), conn_info.isAuthenticated());
+    NimBLEStandIn::read(characteristics[i], unlimited, 0, response);
+
+    remaining -= 2;
+    size_t length = std::min(response.size(), remaining);
+    values[i].data.assign(response.begin(), response.begin() + length);
+    remaining -= length;
+    attrs.push_back({handles[i], 0, &values[i]});
+  }
+
+  ble_gatt_error error = {0, 0};
+  if (cb != nullptr) cb(conn_handle, &error, attrs.data(), attrs.size(), cb_arg);
+  return 0;
+}
+
+bool NimBLEAdvertisementData::addData(const uint8_t* data, size_t length) {
+  if (payload.size() + length > BLE_HS_ADV_MAX_SZ) return false;
+  payload.insert(payload.end(), data, data + length);
+  return true;
+}
+
+bool NimBLEAdvertisementData::removeData(uint8_t type) {
+  for (size_t position = 0; position + 1 < payload.size(); position += payload[position] + 1) {
+    if (payload[position + 1] == type) {
+      payload.erase(payload.begin() + position, payload.begin() + position + payload[position] + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool NimBLEAdvertisementData::setManufacturerData(const uint8_t* data, size_t length) {
+  if (length > 0xFE) return false;
+  removeData(BLE_HS_ADV_TYPE_MFG_DATA);
+
+  std::vector<uint8_t> structure = {static_cast<uint8_t>(length + 1), BLE_HS_ADV_TYPE_MFG_DATA};
+  structure.insert(structure.end(), data, data + length);
+  return addData(structure.data(), structure.size());
+}
+
+bool NimBLEAdvertising::setManufacturerData(const uint8_t* data, size_t length) {
+  if (!advertisement_data.setManufacturerData(data, length)) return false;
+  data_updates++;
+  return true;
+}
+
+NimBLERemoteCharacteristic::NimBLERemoteCharacteristic(NimBLERemoteService* service, const NimBLEUUID& uuid, uint16_t handle, uint8_t properties)
+  : service(service), uuid(uuid), handle(handle), properties(properties) {}
+
+NimBLEAttValue NimBLERemoteCharacteristic::readValue(uint32_t /*timeout_ms*/) {
+  struct Read {
+    NimBLETaskData task_data;
+    std::vector<uint8_t> value;
+  } read;
+
+  NimBLEAttValue value;
+  int rc = ble_gattc_read_long(service->getClient()->getConnHandle(), handle, 0, [](uint16_t, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    Read* read = static_cast<Read*>(arg);
+    if (error->status == 0) {
+      read->value.insert(read->value.end(), attr->om->data.begin(), attr->om->data.end());
+    } else {
+      NimBLEUtils::taskRelease(read->task_data, error->status == BLE_HS_EDONE ? 0 : error->status);
+    }
+    return 0;
+  }, &read);
+  if (rc != 0) return value;
+
+  NimBLEUtils::taskWait(read.task_data, BLE_NPL_TIME_FOREVER);
+  if (read.task_data.m_flags == 0) value.setValue(read.value.data(), read.value.size());
+  return value;
+}
+
+NimBLERemoteService::NimBLERemoteService(NimBLEClient* client, const NimBLEUUID& uuid, uint16_t handle, uint16_t end_handle)
+  : client(client), uuid(uuid), handle(handle), end_handle(end_handle), discovered(false) {}
+
+NimBLERemoteService::~NimBLERemoteService() {
+  for (NimBLERemoteCharacteristic* characteristic : characteristics) {
+    delete characteristic;
+  }
+}
+
+const std::vector<NimBLERemoteCharacteristic*>& NimBLERemoteService::getCharacteristics(bool refresh) {
+  if (discovered && !refresh) return characteristics;
+
+  for (NimBLERemoteCharacteristic* characteristic : characteristics) {
+    delete characteristic;
+  }
+  characteristics.clear();
+
+  NimBLEServer* peer = NimBLEStandInPeer::peer(client);
+  NimBLEService* service = peer != nullptr ? peer->getServiceByHandle(handle) : nullptr;
+  if (service == nullptr) return characteristics;
+
+  // Read By Type (0x2803) until Attribute Not Found, 7-octet declarations per response
+  const size_t declarations_per_response = (client->getMTU() - 2) / 7;
+  size_t count = service->getCharacteristics().size();
+  stand_in_counters.att_requests += (count + declarations_per_response - 1) / declarations_per_response + 1;
+  stand_in_counters.task_waits++;
+
+  for (NimBLECharacteristic* characteristic : service->getCharacteristics()) {
+    characteristics.push_back(new NimBLERemoteCharacteristic(this, characteristic->getUUID(), characteristic->getHandle(), characteristic->getProperties() & 0xFF));
+  }
+  discovered = true;
+  return characteristics;
+}
+
+NimBLERemoteCharacteristic* NimBLERemoteService::getCharacteristic(const NimBLEUUID& uuid) {
+  for (NimBLERemoteCharacteristic* characteristic : getCharacteristics()) {
+    if (characteristic->getUUID() == uuid) return characteristic;
+  }
+  return nullptr;
+}
+
+NimBLEClient::NimBLEClient() : peer(nullptr), read_multiple_variable(false) {}
+
+NimBLEClient::~NimBLEClient() {
+  deleteServices();
+}
+
+bool NimBLEClient::disconnect() {
+  deleteServices();
+  peer = nullptr;
+  return true;
+}
+
+NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
+  for (NimBLERemoteService* service : services) {
+    if (service->getUUID() == uuid) return service;
+  }
+  if (peer == nullptr) return nullptr;
+
+  // Find By Type Value, repeated after a match until Attribute Not Found
+  stand_in_counters.att_requests += 2;
+  stand_in_counters.task_waits++;
+
+  NimBLEService* service = peer->getServiceByUUID(uuid);
+  if (service == nullptr || service->getHandle() == 0) return nullptr;
+
+  NimBLERemoteService* remote_service = new NimBLERemoteService(this, service->getUUID(), service->getHandle(), service->getEndHandle());
+  services.push_back(remote_service);
+  return remote_service;
+}
+
+void NimBLEClient::deleteServices() {
+  for (NimBLERemoteService* service : services) {
+    delete service;
+  }
+  services.clear();
+}
+
+NimBLEUUID::NimBLEUUID() : bit_size(0), value{} {
+  stand_in_counters.uuid_constructions++;
+}
+
+NimBLEUUID::NimBLEUUID(uint16_t uuid) : bit_size(16), value{} {
+  stand_in_counters.uuid_constructions++;
+  value[0] = uuid & 0xFF;
+  value[1] = (uuid >> 8) & 0xFF;
+}
+
+NimBLEUUID::NimBLEUUID(uint32_t uuid) : bit_size(32), value{} {
+  stand_in_counters.uuid_constructions++;
+  for (int i = 0; i < 4; i++) {
+    value[i] = (uuid >> (8 * i)) & 0xFF;
+  }
+}
+
+NimBLEUUID::NimBLEUUID(const char* uuid) : NimBLEUUID(std::string(uuid)) {}
+
+NimBLEUUID::NimBLEUUID(const std::string& uuid) : bit_size(0), value{} {
+  stand_in_counters.uuid_constructions++;
+
+  std::string digits;
+  for (char c : uuid) {
+    if (c != '-') digits += c;
+  }
+  for (char c : digits) {
+    if (hexValue(c) < 0) return;
+  }
+
+  if (digits.size() == 4 || digits.size() == 8) {
+    uint32_t parsed = 0;
+    for (char c : digits) parsed = (parsed << 4) | hexValue(c);
+    bit_size = digits.size() == 4 ? 16 : 32;
+    for (int i = 0; i < bit_size / 8; i++) {
+      value[i] = (parsed >> (8 * i)) & 0xFF;
+    }
+  } else if (digits.size() == 32) {
+    bit_size = 128;
+    for (int i = 0; i < 16; i++) {
+      value[15 - i] = (hexValue(digits[2 * i]) << 4) | hexValue(digits[2 * i + 1]);
+    }
+  }
+}
+
+std::string NimBLEUUID::toString() const {
+  char text[40];
+  if (bit_size == 16) {
+    snprintf(text, sizeof(text), "0x%04x", value[0] | (value[1] << 8));
+  } else if (bit_size == 32) {
+    snprintf(text, sizeof(text), "0x%08x", static_cast<unsigned>(value[0] | (value[1] << 8) | (value[2] << 16) | (value[3] << 24)));
+  } else {
+    char* p = text;
+    for (int i = 15; i >= 0; i--) {
+      p += snprintf(p, 3, "%02x", value[i]);
+      if (i == 12 || i == 10 || i == 8 || i == 6) *p++ = '-';
+    }
+  }
+  return text;
+}
+
+bool NimBLEUUID::operator==(const NimBLEUUID& other) const {
+  if (bit_size == other.bit_size) {
+    return memcmp(value, other.value, bit_size / 8) == 0;
+  }
+
+  // Compare across sizes by expanding both to 128 bits
+  uint8_t a[16];
+  uint8_t b[16];
+  const NimBLEUUID* uuids[2] = {this, &other};
+  uint8_t* expanded[2] = {a, b};
+  for (int n = 0; n < 2; n++) {
+    if (uuids[n]->bit_size == 128) {
+      memcpy(expanded[n], uuids[n]->value, 16);
+    } else {
+      memcpy(expanded[n], BASE_UUID, 16);
+      memcpy(expanded[n] + 12, uuids[n]->value, uuids[n]->bit_size / 8);
+    }
+  }
+  return memcmp(a, b, 16) == 0;
+}
+
+std::string NimBLEAddress::toString() const {
+  char text[18];
+  snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", value[5], value[4], value[3], value[2], value[1], value[0]);
+  return text;
+}
+
+NimBLEAttValue::NimBLEAttValue(uint16_t init_len, uint16_t max_len)
+  : buffer(nullptr), value_length(0), buffer_capacity(std::min(init_len, max_len)), max_length(max_len) {
+  buffer = new uint8_t[buffer_capacity + 1];
+  buffer[0] = 0;
+  stand_in_counters.value_allocations++;
+  stand_in_counters.value_bytes_allocated += buffer_capacity + 1;
+}
+
+NimBLEAttValue::NimBLEAttValue(const NimBLEAttValue& source)
+  : buffer(nullptr), value_length(source.value_length), buffer_capacity(source.buffer_capacity), max_length(source.max_length) {
+  buffer = new uint8_t[buffer_capacity + 1];
+  memcpy(buffer, source.buffer, value_length + 1);
+  stand_in_counters.value_allocations++;
+  stand_in_counters.value_bytes_allocated += buffer_capacity + 1;
+}
+
+NimBLEAttValue& NimBLEAttValue::operator=(const NimBLEAttValue& source) {
+  if (this != &source) {
+    max_length = source.max_length;
+    setValue(source.buffer, source.value_length);
+  }
+  return *this;
+}
+
+NimBLEAttValue::~NimBLEAttValue() {
+  delete[] buffer;
+}
+
+bool NimBLEAttValue::setValue(const uint8_t* data, size_t length) {
+  if (length > max_length) return false;
+
+  if (length > buffer_capacity) {
+    uint8_t* grown = new uint8_t[length + 1];
+    delete[] buffer;
+    buffer = grown;
+    buffer_capacity = length;
+    stand_in_counters.value_allocations++;
+    stand_in_counters.value_bytes_allocated += length + 1;
+  }
+  if (length > 0) memcpy(buffer, data, length);
+  buffer[length] = 0;
+  value_length = length;
+  return true;
+}
+
+NimBLEDescriptor::NimBLEDescriptor(const NimBLEUUID& uuid, uint16_t properties, uint16_t max_len, NimBLECharacteristic* characteristic)
+  : uuid(uuid), handle(0), properties(properties), characteristic(characteristic),
+    value(std::min<uint16_t>(CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH, max_len), max_len) {}
+
+NimBLE2904::NimBLE2904(NimBLECharacteristic* characteristic)
+  : NimBLEDescriptor(NimBLEUUID(static_cast<uint16_t>(0x2904)), NIMBLE_PROPERTY::READ, 7, characteristic),
+    format(0), exponent(0), unit(0), namespace_value(0), description(0) {
+  commit();
+}
+
+void NimBLE2904::setFormat(uint8_t format) {
+  this->format = format;
+  commit();
+}
+
+void NimBLE2904::setExponent(int8_t exponent) {
+  this->exponent = exponent;
+  commit();
+}
+
+void NimBLE2904::setUnit(uint16_t unit) {
+  this->unit = unit;
+  commit();
+}
+
+void NimBLE2904::setNamespace(uint8_t namespace_value) {
+  this->namespace_value = namespace_value;
+  commit();
+}
+
+void NimBLE2904::setDescription(uint16_t description) {
+  this->description = description;
+  commit();
+}
+
+void NimBLE2904::commit() {
+  uint8_t data[] = {
+    format,
+    static_cast<uint8_t>(exponent),
+    static_cast<uint8_t>(unit & 0xFF),
+    static_cast<uint8_t>((unit >> 8) & 0xFF),
+    namespace_value,
+    static_cast<uint8_t>(description & 0xFF),
+    static_cast<uint8_t>((description >> 8) & 0xFF)
+  };
+  value.setValue(data, sizeof(data));
+}
+
+NimBLECharacteristic::NimBLECharacteristic(const NimBLEUUID& uuid, uint16_t properties, uint16_t max_len, NimBLEService* service)
+  : uuid(uuid), handle(0), properties(properties), service(service), callbacks(nullptr),
+    value(std::min<uint16_t>(CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH, max_len), max_len) {}
+
+NimBLECharacteristic::~NimBLECharacteristic() {
+  for (NimBLEDescriptor* descriptor : descriptors) {
+    delete descriptor;
+  }
+}
+
+NimBLEDescriptor* NimBLECharacteristic::createDescriptor(const NimBLEUUID& uuid, uint32_t properties, uint16_t max_len) {
+  // NimBLE-Arduino hands out a NimBLE2904 for this UUID so the result can be cast
+  if (uuid == NimBLEUUID(static_cast<uint16_t>(0x2904))) {
+    return create2904();
+  }
+
+  NimBLEDescriptor* descriptor = new NimBLEDescriptor(uuid, properties, max_len, this);
+  descriptors.push_back(descriptor);
+  return descriptor;
+}
+
+NimBLE2904* NimBLECharacteristic::create2904() {
+  NimBLE2904* descriptor = new NimBLE2904(this);
+  descriptors.push_back(descriptor);
+  return descriptor;
+}
+
+NimBLEDescriptor* NimBLECharacteristic::getDescriptorByUUID(const NimBLEUUID& uuid) const {
+  for (NimBLEDescriptor* descriptor : descriptors) {
+    if (descriptor->getUUID() == uuid) return descriptor;
+  }
+  return nullptr;
+}
+
+NimBLEService::NimBLEService(const NimBLEUUID& uuid, NimBLEServer* server)
+  : uuid(uuid), handle(0), end_handle(0), started(false), server(server) {}
+
+NimBLEService::~NimBLEService() {
+  for (NimBLECharacteristic* characteristic : characteristics) {
+    delete characteristic;
+  }
+}
+
+NimBLECharacteristic* NimBLEService::createCharacteristic(const NimBLEUUID& uuid, uint32_t properties, uint16_t max_len) {
+  NimBLECharacteristic* characteristic = new NimBLECharacteristic(uuid, properties, max_len, this);
+  characteristics.push_back(characteristic);
+  return characteristic;
+}
+
+NimBLECharacteristic* NimBLEService::getCharacteristic(const NimBLEUUID& uuid, uint16_t instance_id) const {
+  uint16_t position = 0;
+  for (NimBLECharacteristic* characteristic : characteristics) {
+    if (characteristic->getUUID() == uuid) {
+      if (position == instance_id) return characteristic;
+      position++;
+    }
+  }
+  return nullptr;
+}
+
+NimBLECharacteristic* NimBLEService::getCharacteristicByHandle(uint16_t handle) const {
+  for (NimBLECharacteristic* characteristic : characteristics) {
+    if (characteristic->getHandle() == handle) return characteristic;
+  }
+  return nullptr;
+}
+
+bool NimBLEService::start() {
+  started = true;
+  return true;
+}
+
+NimBLEServer::NimBLEServer() : started(false), next_handle(FIRST_APPLICATION_HANDLE) {}
+
+NimBLEServer::~NimBLEServer() {
+  for (NimBLEService* service : services) {
+    delete service;
+  }
+}
+
+NimBLEService* NimBLEServer::createService(const NimBLEUUID& uuid) {
+  NimBLEService* service = new NimBLEService(uuid, this);
+  services.push_back(service);
+  return service;
+}
+
+NimBLEService* NimBLEServer::getServiceByUUID(const NimBLEUUID& uuid, uint16_t instance_id) const {
+  uint16_t position = 0;
+  for (NimBLEService* service : services) {
+    if (service->getUUID() == uuid) {
+      if (position == instance_id) return service;
+      position++;
+    }
+  }
+  return nullptr;
+}
+
+NimBLEService* NimBLEServer::getServiceByHandle(uint16_t handle) const {
+  for (NimBLEService* service : services) {
+    if (service->getHandle() == handle) return service;
+  }
+  return nullptr;
+}
+
+void NimBLEServer::start() {
+  // Handles follow registration order: service declaration, then for each characteristic
+  // its declaration, its value and its descriptors
+  next_handle = FIRST_APPLICATION_HANDLE;
+  for (NimBLEService* service : services) {
+    if (!service->isStarted()) continue;
+
+    service->handle = next_handle++;
+    for (NimBLECharacteristic* characteristic : service->characteristics) {
+      next_handle++;
+      characteristic->handle = next_handle++;
+      for (NimBLEDescriptor* descriptor : characteristic->descriptors) {
+        descriptor->handle = next_handle++;
+      }
+    }
+    service->end_handle = next_handle - 1;
+  }
+  started = true;
+}
+
+bool NimBLEDevice::init(const std::string& /*device_name*/) {
+  return true;
+}
+
+bool NimBLEDevice::deinit(bool clear_all) {
+  if (clear_all) {
+    for (NimBLEClient* client : device_clients) {
+      delete client;
+    }
+    device_clients.clear();
+    delete device_advertising;
+    device_advertising = nullptr;
+    delete device_server;
+    device_server = nullptr;
+  }
+  return true;
+}
+
+NimBLEServer* NimBLEDevice::createServer() {
+  if (device_server == nullptr) {
+    device_server = new NimBLEServer();
+  }
+  return device_server;
+}
+
+NimBLEServer* NimBLEDevice::getServer() {
+  return device_server;
+}
+
+
+NimBLEClient* NimBLEDevice::createClient() {
+  NimBLEClient* client = new NimBLEClient();
+  device_clients.push_back(client);
+  return client;
+}
+
+bool NimBLEDevice::deleteClient(NimBLEClient* client) {
+  auto position = std::find(device_clients.begin(), device_clients.end(), client);
+  if (position == device_clients.end()) return false;
+
+  device_clients.erase(position);
+  delete client;
+  return true;
+}
+
+NimBLEAdvertising* NimBLEDevice::getAdvertising() {
+  if (device_advertising == nullptr) {
+    device_advertising = new NimBLEAdvertising();
+  }
+  return device_advertising;
+}
\ No newline at end of file
@@ -0,0 +1,610 @@
+#ifndef NIMBLE_STAND_IN_NIMBLEDEVICE_H
+#define NIMBLE_STAND_IN_NIMBLEDEVICE_H
+
+/**
+ * @brief Host-side stand-in for the subset of NimBLE-Arduino used by BTDevInf
+ * @note This is not a Bluetooth stack. It models the NimBLE-Arduino 2.x object graph (server, services, characteristics, descriptors), its attribute value storage and its attribute handle assignment closely enough to build, exercise and measure BTDevInf on a Linux host.
+ * @note Only the API surface BTDevInf and its host tools use is provided. Signatures follow NimBLE-Arduino so that library code compiles unchanged against either.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define BLE_ATT_ATTR_MAX_LEN 512
+#define CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH 20
+
+namespace NIMBLE_PROPERTY {
+  enum : uint16_t {
+    BROADCAST = 0x0001,
+    READ = 0x0002,
+    WRITE_NR = 0x0004,
+    WRITE = 0x0008,
+    NOTIFY = 0x0010,
+    INDICATE = 0x0020,
+    WRITE_SIGNED = 0x0040,
+    READ_ENC = 0x0200,
+    READ_AUTHEN = 0x0400,
+    READ_AUTHOR = 0x0800,
+    WRITE_ENC = 0x1000,
+    WRITE_AUTHEN = 0x2000,
+    WRITE_AUTHOR = 0x4000
+  };
+}
+
+class NimBLEServer;
+class NimBLEService;
+class NimBLECharacteristic;
+class NimBLEDescriptor;
+class NimBLE2904;
+class NimBLEClient;
+class NimBLERemoteService;
+class NimBLERemoteCharacteristic;
+
+/**
+ * @brief Bluetooth UUID (16, 32 or 128 bit)
+ */
+class NimBLEUUID {
+  public:
+    NimBLEUUID();
+    NimBLEUUID(uint16_t uuid);
+    NimBLEUUID(uint32_t uuid);
+    NimBLEUUID(const std::string& uuid);
+    NimBLEUUID(const char* uuid);
+
+    uint8_t bitSize() const { return bit_size; }
+    const uint8_t* getValue() const { return value; }
+    std::string toString() const;
+
+    bool operator==(const NimBLEUUID& other) const;
+    bool operator!=(const NimBLEUUID& other) const { return !(*this == other); }
+
+  private:
+    uint8_t bit_size;
+    uint8_t value[16];
+};
+
+/**
+ * @brief Bluetooth device address
+ */
+class NimBLEAddress {
+  public:
+    NimBLEAddress() : value{}, type(0) {}
+    NimBLEAddress(const uint8_t address[6], uint8_t type) : type(type) { memcpy(value, address, 6); }
+
+    const uint8_t* getVal() const { return value; }
+    uint8_t getType() const { return type; }
+    bool isNull() const { return memcmp(value, "\0\0\0\0\0\0", 6) == 0; }
+    std::string toString() const;
+
+    bool operator==(const NimBLEAddress& other) const { return type == other.type && memcmp(value, other.value, 6) == 0; }
+    bool operator!=(const NimBLEAddress& other) const { return !(*this == other); }
+
+  private:
+    uint8_t value[6]; // Least significant octet first, as NimBLE stores it
+    uint8_t type;
+};
+
+/**
+ * @brief Attribute value storage, modelled on NimBLEAttValue
+ * @note The buffer starts at min(CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH, max_len) octets and is reallocated to the exact length whenever a larger value is set, as NimBLE-Arduino does.
+ */
+class NimBLEAttValue {
+  public:
+    NimBLEAttValue(uint16_t init_len = CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH, uint16_t max_len = BLE_ATT_ATTR_MAX_LEN);
+    NimBLEAttValue(const NimBLEAttValue& source);
+    NimBLEAttValue& operator=(const NimBLEAttValue& source);
+    ~NimBLEAttValue();
+
+    bool setValue(const uint8_t* data, size_t length);
+
+    const uint8_t* data() const { return buffer; }
+    uint16_t size() const { return value_length; }
+    uint16_t length() const { return value_length; }
+    uint16_t capacity() const { return buffer_capacity; }
+    uint16_t max_size() const { return max_length; }
+
+  private:
+    uint8_t* buffer;
+    uint16_t value_length;
+    uint16_t buffer_capacity;
+    uint16_t max_length;
+};
+
+/**
+ * @brief Connection information passed to attribute callbacks
+ */
+class NimBLEConnInfo {
+  public:
+    NimBLEConnInfo(uint16_t conn_handle = 0, uint16_t mtu = 23, bool encrypted = false, bool authenticated = false, uint16_t conn_interval = 24)
+      : conn_handle(conn_handle), mtu(mtu), encrypted(encrypted), authenticated(authenticated), conn_interval(conn_interval) {}
+
+    uint16_t getConnHandle() const { return conn_handle; }
+    uint16_t getMTU() const { return mtu; }
+    bool isEncrypted() const { return encrypted; }
+    bool isAuthenticated() const { return authenticated; }
+    uint16_t getConnInterval() const { return conn_interval; } // In units of 1.25 ms
+
+  private:
+    uint16_t conn_handle;
+    uint16_t mtu;
+    bool encrypted;
+    bool authenticated;
+    uint16_t conn_interval;
+};
+
+/**
+ * @brief Callbacks for characteristic events
+ */
+class NimBLECharacteristicCallbacks {
+  public:
+    virtual ~NimBLECharacteristicCallbacks() {}
+    virtual void onRead(NimBLECharacteristic* /*characteristic*/, NimBLEConnInfo& /*conn_info*/) {}
+    virtual void onWrite(NimBLECharacteristic* /*characteristic*/, NimBLEConnInfo& /*conn_info*/) {}
+};
+
+/**
+ * @brief A local GATT descriptor
+ */
+class NimBLEDescriptor {
+  public:
+    NimBLEDescriptor(const NimBLEUUID& uuid, uint16_t properties, uint16_t max_len, NimBLECharacteristic* characteristic);
+    virtual ~NimBLEDescriptor() {}
+
+    const NimBLEUUID& getUUID() const { return uuid; }
+    uint16_t getHandle() const { return handle; }
+    uint16_t getProperties() const { return properties; }
+    NimBLECharacteristic* getCharacteristic() const { return characteristic; }
+
+    void setValue(const uint8_t* data, size_t length) { value.setValue(data, length); }
+    void setValue(const std::string& data) { value.setValue(reinterpret_cast<const uint8_t*>(data.data()), data.size()); }
+    void setValue(const char* data) { value.setValue(reinterpret_cast<const uint8_t*>(data), strlen(data)); }
+    NimBLEAttValue getValue() const { return value; }
+    uint16_t getLength() const { return value.size(); }
+    const NimBLEAttValue& getAttVal() const { return value; }
+
+  protected:
+    friend class NimBLEServer;
+
+    NimBLEUUID uuid;
+    uint16_t handle;
+    uint16_t properties;
+    NimBLECharacteristic* characteristic;
+    NimBLEAttValue value;
+};
+
+/**
+ * @brief Characteristic Presentation Format (0x2904) descriptor
+ */
+class NimBLE2904 : public NimBLEDescriptor {
+  public:
+    NimBLE2904(NimBLECharacteristic* characteristic);
+
+    static const uint8_t FORMAT_BOOLEAN = 1;
+    static const uint8_t FORMAT_UINT2 = 2;
+    static const uint8_t FORMAT_UINT4 = 3;
+    static const uint8_t FORMAT_UINT8 = 4;
+    static const uint8_t FORMAT_UINT12 = 5;
+    static const uint8_t FORMAT_UINT16 = 6;
+    static const uint8_t FORMAT_UINT24 = 7;
+    static const uint8_t FORMAT_UINT32 = 8;
+    static const uint8_t FORMAT_UINT48 = 9;
+    static const uint8_t FORMAT_UINT64 = 10;
+    static const uint8_t FORMAT_UINT128 = 11;
+    static const uint8_t FORMAT_SINT8 = 12;
+    static const uint8_t FORMAT_SINT12 = 13;
+    static const uint8_t FORMAT_SINT16 = 14;
+    static const uint8_t FORMAT_SINT24 = 15;
+    static const uint8_t FORMAT_SINT32 = 16;
+    static const uint8_t FORMAT_SINT48 = 17;
+    static const uint8_t FORMAT_SINT64 = 18;
+    static const uint8_t FORMAT_SINT128 = 19;
+    static const uint8_t FORMAT_FLOAT32 = 20;
+    static const uint8_t FORMAT_FLOAT64 = 21;
+    static const uint8_t FORMAT_SFLOAT16 = 22;
+    static const uint8_t FORMAT_SFLOAT32 = 23;
+    static const uint8_t FORMAT_IEEE20601 = 24;
+    static const uint8_t FORMAT_UTF8 = 25;
+    static const uint8_t FORMAT_UTF16 = 26;
+    static const uint8_t FORMAT_OPAQUE = 27;
+
+    void setFormat(uint8_t format);
+    void setExponent(int8_t exponent);
+    void setUnit(uint16_t unit);
+    void setNamespace(uint8_t namespace_value);
+    void setDescription(uint16_t description);
+
+  private:
+    void commit();
+
+    uint8_t format;
+    int8_t exponent;
+    uint16_t unit;
+    uint8_t namespace_value;
+    uint16_t description;
+};
+
+/**
+ * @brief A local GATT characteristic
+ */
+class NimBLECharacteristic {
+  public:
+    NimBLECharacteristic(const NimBLEUUID& uuid, uint16_t properties, uint16_t max_len, NimBLEService* service);
+    ~NimBLECharacteristic();
+
+    NimBLEDescriptor* createDescriptor(const NimBLEUUID& uuid, uint32_t properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE, uint16_t max_len = BLE_ATT_ATTR_MAX_LEN);
+    NimBLE2904* create2904();
+    NimBLEDescriptor* getDescriptorByUUID(const NimBLEUUID& uuid) const;
+    const std::vector<NimBLEDescriptor*>& getDescriptors() const { return descriptors; }
+
+    const NimBLEUUID& getUUID() const { return uuid; }
+    uint16_t getHandle() const { return handle; }
+    uint16_t getProperties() const { return properties; }
+    NimBLEService* getService() const { return service; }
+
+    void setCallbacks(NimBLECharacteristicCallbacks* callbacks) { this->callbacks = callbacks; }
+    NimBLECharacteristicCallbacks* getCallbacks() const { return callbacks; }
+
+    void setValue(const uint8_t* data, size_t length) { value.setValue(data, length); }
+    void setValue(const std::string& data) { value.setValue(reinterpret_cast<const uint8_t*>(data.data()), data.size()); }
+    void setValue(const char* data) { value.setValue(reinterpret_cast<const uint8_t*>(data), strlen(data)); }
+    NimBLEAttValue getValue() const { return value; }
+    uint16_t getLength() const { return value.size(); }
+    const NimBLEAttValue& getAttVal() const { return value; }
+
+  private:
+    friend class NimBLEServer;
+
+    NimBLEUUID uuid;
+    uint16_t handle;
+    uint16_t properties;
+    NimBLEService* service;
+    NimBLECharacteristicCallbacks* callbacks;
+    NimBLEAttValue value;
+    std::vector<NimBLEDescriptor*> descriptors;
+};
+
+/**
+ * @brief A local GATT service
+ */
+class NimBLEService {
+  public:
+    NimBLEService(const NimBLEUUID& uuid, NimBLEServer* server);
+    ~NimBLEService();
+
+    NimBLECharacteristic* createCharacteristic(const NimBLEUUID& uuid, uint32_t properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE, uint16_t max_len = BLE_ATT_ATTR_MAX_LEN);
+    NimBLECharacteristic* getCharacteristic(const NimBLEUUID& uuid, uint16_t instance_id = 0) const;
+    NimBLECharacteristic* getCharacteristicByHandle(uint16_t handle) const;
+    const std::vector<NimBLECharacteristic*>& getCharacteristics() const { return characteristics; }
+
+    bool start();
+    bool isStarted() const { return started; }
+
+    const NimBLEUUID& getUUID() const { return uuid; }
+    uint16_t getHandle() const { return handle; }
+    uint16_t getEndHandle() const { return end_handle; }
+    NimBLEServer* getServer() const { return server; }
+
+  private:
+    friend class NimBLEServer;
+
+    NimBLEUUID uuid;
+    uint16_t handle;
+    uint16_t end_handle;
+    bool started;
+    NimBLEServer* server;
+    std::vector<NimBLECharacteristic*> characteristics;
+};
+
+/**
+ * @brief The GATT server
+ * @note Attribute handles are assigned by start(), which NimBLE-Arduino runs when advertising starts. Handle 1 to 9 are kept for the GAP and GATT services the stack registers itself.
+ */
+class NimBLEServer {
+  public:
+    NimBLEServer();
+    ~NimBLEServer();
+
+    NimBLEService* createService(const NimBLEUUID& uuid);
+    NimBLEService* getServiceByUUID(const NimBLEUUID& uuid, uint16_t instance_id = 0) const;
+    NimBLEService* getServiceByHandle(uint16_t handle) const;
+    const std::vector<NimBLEService*>& getServices() const { return services; }
+
+    void start();
+    bool isStarted() const { return started; }
+    uint16_t getAttributeCount() const { return next_handle - FIRST_APPLICATION_HANDLE; }
+
+    static const uint16_t FIRST_APPLICATION_HANDLE = 10;
+
+  private:
+    bool started;
+    uint16_t next_handle;
+    std::vector<NimBLEService*> services;
+};
+
+/**
+ * @brief A characteristic discovered on a peer
+ */
+class NimBLERemoteCharacteristic {
+  public:
+    NimBLERemoteCharacteristic(NimBLERemoteService* service, const NimBLEUUID& uuid, uint16_t handle, uint8_t properties);
+
+    const NimBLEUUID& getUUID() const { return uuid; }
+    uint16_t getHandle() const { return handle; }
+    bool canRead() const { return properties & NIMBLE_PROPERTY::READ; }
+    NimBLERemoteService* getRemoteService() const { return service; }
+
+    NimBLEAttValue readValue(uint32_t timeout_ms = UINT32_MAX);
+
+  private:
+    NimBLERemoteService* service;
+    NimBLEUUID uuid;
+    uint16_t handle;
+    uint8_t properties;
+};
+
+/**
+ * @brief A service discovered on a peer
+ */
+class NimBLERemoteService {
+  public:
+    NimBLERemoteService(NimBLEClient* client, const NimBLEUUID& uuid, uint16_t handle, uint16_t end_handle);
+    ~NimBLERemoteService();
+
+    const NimBLEUUID& getUUID() const { return uuid; }
+    uint16_t getHandle() const { return handle; }
+    uint16_t getEndHandle() const { return end_handle; }
+    NimBLEClient* getClient() const { return client; }
+
+    const std::vector<NimBLERemoteCharacteristic*>& getCharacteristics(bool refresh = false);
+    NimBLERemoteCharacteristic* getCharacteristic(const NimBLEUUID& uuid);
+
+  private:
+    NimBLEClient* client;
+    NimBLEUUID uuid;
+    uint16_t handle;
+    uint16_t end_handle;
+    bool discovered;
+    std::vector<NimBLERemoteCharacteristic*> characteristics;
+};
+
+namespace NimBLEStandIn {
+  bool connect(NimBLEClient* client, NimBLEServer* peer, const NimBLEConnInfo& conn_info, bool read_multiple_variable);
+}
+
+/**
+ * @brief A GATT client connection
+ * @note On the host a client is connected to a local NimBLEServer with NimBLEStandIn::connect(), which plays the peer.
+ */
+class NimBLEClient {
+  public:
+    NimBLEClient();
+    ~NimBLEClient();
+
+    bool isConnected() const { return peer != nullptr; }
+    bool disconnect();
+    uint16_t getConnHandle() const { return conn_info.getConnHandle(); }
+    uint16_t getMTU() const { return conn_info.getMTU(); }
+    NimBLEConnInfo getConnInfo() const { return conn_info; }
+    NimBLEAddress getPeerAddress() const { return peer_address; }
+    bool setPeerAddress(const NimBLEAddress& address) { peer_address = address; return true; }
+
+    NimBLERemoteService* getService(const NimBLEUUID& uuid);
+    void deleteServices();
+
+  private:
+    friend bool NimBLEStandIn::connect(NimBLEClient*, NimBLEServer*, const NimBLEConnInfo&, bool);
+    friend class NimBLEStandInPeer;
+
+    NimBLEServer* peer;
+    NimBLEAddress peer_address;
+    NimBLEConnInfo conn_info;
+    bool read_multiple_variable;
+    std::vector<NimBLERemoteService*> services;
+};
+
+#define BLE_HS_ADV_TYPE_MFG_DATA 0xFF
+#define BLE_HS_ADV_MAX_SZ 31
+
+/**
+ * @brief Advertising or scan response payload, a sequence of AD structures
+ */
+class NimBLEAdvertisementData {
+  public:
+    bool addData(const uint8_t* data, size_t length);
+    bool removeData(uint8_t type);
+    bool setManufacturerData(const uint8_t* data, size_t length);
+    void clearData() { payload.clear(); }
+
+    std::vector<uint8_t> getPayload() const { return payload; }
+
+  private:
+    std::vector<uint8_t> payload;
+};
+
+/**
+ * @brief Legacy advertising
+ * @note The stand-in only keeps the payloads and counts how often the controller would be handed new data.
+ */
+class NimBLEAdvertising {
+  public:
+    NimBLEAdvertising() : advertising(false), scan_response(false), data_updates(0) {}
+
+    bool setAdvertisementData(const NimBLEAdvertisementData& data) { advertisement_data = data; data_updates++; return true; }
+    bool setScanResponseData(const NimBLEAdvertisementData& data) { scan_response_data = data; data_updates++; return true; }
+    bool setManufacturerData(const uint8_t* data, size_t length);
+    bool enableScanResponse(bool enable) { scan_response = enable; return true; }
+    bool refreshAdvertisingData() { return advertising; }
+
+    bool start() { advertising = true; return true; }
+    bool stop() { advertising = false; return true; }
+    bool isAdvertising() const { return advertising; }
+
+    const NimBLEAdvertisementData& getAdvertisementData() const { return advertisement_data; }
+    const NimBLEAdvertisementData& getScanResponseData() const { return scan_response_data; }
+    bool isScanResponseEnabled() const { return scan_response; }
+    uint32_t getDataUpdates() const { return data_updates; }
+
+  private:
+    NimBLEAdvertisementData advertisement_data;
+    NimBLEAdvertisementData scan_response_data;
+    bool advertising;
+    bool scan_response;
+    uint32_t data_updates;
+};
+
+/**
+ * @brief Stack entry point
+ */
+class NimBLEDevice {
+  public:
+    static bool init(const std::string& device_name);
+    static bool deinit(bool clear_all = false);
+    static NimBLEServer* createServer();
+    static NimBLEServer* getServer();
+    static NimBLEClient* createClient();
+    static bool deleteClient(NimBLEClient* client);
+    static NimBLEAdvertising* getAdvertising();
+};
+
+/**
+ * @brief Lets a task block until a NimBLE host callback releases it
+ * @note The stand-in runs host callbacks inside the call that starts a procedure, so the task is always released before it waits.
+ */
+struct NimBLETaskData {
+  NimBLETaskData(void* instance = nullptr, int flags = 0, void* buffer = nullptr)
+    : m_pInstance(instance), m_flags(flags), m_pBuf(buffer), released(false) {}
+
+  void* m_pInstance;
+  mutable int m_flags;
+  void* m_pBuf;
+  mutable bool released;
+};
+
+class NimBLEUtils {
+  public:
+    static bool taskWait(const NimBLETaskData& task_data, uint32_t timeout);
+    static void taskRelease(const NimBLETaskData& task_data, int rc = 0);
+};
+
+#define BLE_NPL_TIME_FOREVER UINT32_MAX
+
+/**
+ * @brief Flat stand-in for the NimBLE mbuf chain holding received attribute data
+ */
+struct os_mbuf {
+  std::vector<uint8_t> data;
+};
+
+#define OS_MBUF_PKTLEN(om) (static_cast<uint16_t>((om)->data.size()))
+int os_mbuf_copydata(const struct os_mbuf* om, int off, int len, void* dst);
+
+struct ble_gatt_error {
+  uint16_t status;
+  uint16_t att_handle;
+};
+
+struct ble_gatt_attr {
+  uint16_t handle;
+  uint16_t offset;
+  struct os_mbuf* om;
+};
+
+typedef int ble_gatt_attr_fn(uint16_t conn_handle, const struct ble_gatt_error* error, struct ble_gatt_attr* attr, void* arg);
+typedef int ble_gatt_attr_mult_fn(uint16_t conn_handle, const struct ble_gatt_error* error, struct ble_gatt_attr* attrs, uint8_t num_attrs, void* arg);
+
+int ble_gattc_read(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_attr_fn* cb, void* cb_arg);
+int ble_gattc_read_long(uint16_t conn_handle, uint16_t handle, uint16_t offset, ble_gatt_attr_fn* cb, void* cb_arg);
+int ble_gattc_read_mult_var(uint16_t conn_handle, const uint16_t* handles, uint8_t num_handles, ble_gatt_attr_mult_fn* cb, void* cb_arg);
+
+#define MYNEWT_VAL_BLE_GATT_READ_MULT_VAR 1
+
+typedef uint32_t ble_npl_time_t;
+
+/**
+ * @brief NimBLE porting layer clock, in ticks of one millisecond on the host
+ */
+ble_npl_time_t ble_npl_time_get(void);
+uint32_t ble_npl_time_ticks_to_ms32(ble_npl_time_t ticks);
+void ble_npl_time_delay(ble_npl_time_t ticks);
+
+#define BLE_HS_CONN_HANDLE_NONE 0xFFFF
+
+#define BLE_HS_ENOENT 5
+#define BLE_HS_ENOTCONN 7
+#define BLE_HS_EINVAL 3
+#define BLE_HS_EDONE 14
+#define BLE_HS_ERR_ATT_BASE 0x100
+#define BLE_HS_ATT_ERR(x) ((x) ? BLE_HS_ERR_ATT_BASE + (x) : 0)
+
+#define BLE_ATT_ERR_INVALID_HANDLE 0x01
+#define BLE_ATT_ERR_READ_NOT_PERMITTED 0x02
+#define BLE_ATT_ERR_INSUFFICIENT_AUTHEN 0x05
+#define BLE_ATT_ERR_REQ_NOT_SUPPORTED 0x06
+#define BLE_ATT_ERR_INVALID_OFFSET 0x07
+#define BLE_ATT_ERR_INSUFFICIENT_ENC 0x0F
+
+/**
+ * @brief Host-only helpers of the stand-in: measurement counters and a simulated ATT peer
+ */
+namespace NimBLEStandIn {
+  struct Counters {
+    uint32_t uuid_constructions;
+    uint32_t value_allocations;
+    uint32_t value_bytes_allocated;
+    uint32_t att_requests; // Requests sent by stand-in clients, discovery included
+    uint32_t task_waits;   // NimBLEUtils::taskWait() calls, one per time an application task blocks on the host
+    uint32_t nvs_reads;    // Keys read through the NVS stand-in in nvs.h
+    uint32_t nvs_writes;
+  };
+
+  Counters& counters();
+  void resetCounters();
+
+  /**
+   * @brief Serve one ATT Read (offset 0) or Read Blob request for a characteristic value
+   * @param characteristic The characteristic being read
+   * @param conn_info The connection the request arrives on; its MTU bounds the response
+   * @param offset Value offset of the request, 0 for a Read Request
+   * @param response Receives at most MTU-1 octets of the value starting at offset
+   * @return 0 or the ATT error code the request fails with
+   * @note Follows NimBLE: permissions are checked before any callback, and onRead runs only for the first request of a read (offset 0), so every Read Blob that follows is served from the value onRead left behind.
+   */
+  int read(NimBLECharacteristic* characteristic, NimBLEConnInfo& conn_info, uint16_t offset, std::vector<uint8_t>& response);
+
+  /**
+   * @brief Read a complete characteristic value as a client would: one Read followed by Read Blob requests until a response is shorter than MTU-1
+   * @param round_trips If not null, receives the number of ATT requests used
+   * @return 0 or the ATT error code of the first failed request
+   */
+  int readLong(NimBLECharacteristic* characteristic, NimBLEConnInfo& conn_info, std::vector<uint8_t>& value, uint16_t* round_trips = nullptr);
+
+  /**
+   * @brief ATT requests a client needs to discover one service, all its characteristics and all their descriptors
+   */
+  struct DiscoveryCost {
+    uint16_t service_requests;        // Find By Type Value until Attribute Not Found
+    uint16_t characteristic_requests; // Read By Type (0x2803) until Attribute Not Found
+    uint16_t descriptor_requests;     // Find Information over each characteristic's descriptor range
+    uint16_t descriptor_reads;        // One Read per descriptor, for clients that fetch them
+    uint16_t attribute_handles;       // Handles of the service, declaration included
+  };
+
+  /**
+   * @brief Count the ATT round-trips of full discovery of a service with 16-bit UUIDs at a given MTU
+   * @note The server must have been started so that handles are assigned.
+   */
+  DiscoveryCost discover(NimBLEServer* server, const NimBLEUUID& service_uuid, uint16_t mtu);
+
+  /**
+   * @brief Connect a client to a local server that plays the peer
+   * @param conn_info Connection handle, MTU and link security as the peer sees them
+   * @param read_multiple_variable Whether the peer supports Read Multiple Variable Length requests
+   * @note The peer server must have been started. Every ATT request the client sends is counted in Counters::att_requests.
+   */
+  bool connect(NimBLEClient* client, NimBLEServer* peer, const NimBLEConnInfo& conn_info, bool read_multiple_variable = true);
+}
+
+#endif // NIMBLE_STAND_IN_NIMBLEDEVICE_H
@@ -0,0 +1,13 @@
+#ifndef NIMBLE_STAND_IN_NIMBLELOG_H
+#define NIMBLE_STAND_IN_NIMBLELOG_H
+
+/**
+ * @brief Host-side stand-in for the NimBLE-Arduino log macros used by the library
+ * @note Messages go to stderr, so they never mix with the JSON lines the benchmarks print on stdout.
+ */
+
+#include <cstdio>
+
+#define NIMBLE_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+
+#endif // NIMBLE_STAND_IN_NIMBLELOG_H
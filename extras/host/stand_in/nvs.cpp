@@ -0,0 +1,99 @@
+#include "nvs.h"
+#include "NimBLEDevice.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+  std::string nvs_directory = ".";
+  std::vector<std::string> nvs_namespaces;
+
+  bool keyPath(nvs_handle_t handle, const char* key, char (&path)[512]) {
+    if (handle == 0 || handle > nvs_namespaces.size() || nvs_namespaces[handle - 1].empty()) return false;
+    int length = snprintf(path, sizeof(path), "%s/%s.%s", nvs_directory.c_str(), nvs_namespaces[handle - 1].c_str(), key);
+    return length > 0 && static_cast<size_t>(length) < sizeof(path);
+  }
+
+  // Reads straight into the caller's buffer, so the stand-in adds no heap allocations to what is measured
+  esp_err_t readKey(nvs_handle_t handle, const char* key, void* out_value, size_t capacity, size_t& length) {
+    char path[512];
+    if (!keyPath(handle, key, path)) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return ESP_ERR_NVS_NOT_FOUND;
+    NimBLEStandIn::counters().nvs_reads++;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    length = size < 0 ? 0 : size;
+
+    esp_err_t result = ESP_OK;
+    if (out_value != nullptr) {
+      if (capacity < length) {
+        result = ESP_ERR_NVS_INVALID_LENGTH;
+      } else if (fread(out_value, 1, length, file) != length) {
+        result = ESP_FAIL;
+      }
+    }
+    fclose(file);
+    return result;
+  }
+
+  esp_err_t writeKey(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    char path[512];
+    if (!keyPath(handle, key, path)) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) return ESP_FAIL;
+    NimBLEStandIn::counters().nvs_writes++;
+
+    bool written = fwrite(value, 1, length, file) == length;
+    return fclose(file) == 0 && written ? ESP_OK : ESP_FAIL;
+  }
+}
+
+void NimBLEStandIn::setNvsDirectory(const char* path) {
+  nvs_directory = path;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t, nvs_handle_t* out_handle) {
+  if (name == nullptr || *name == '\0' || out_handle == nullptr) return ESP_FAIL;
+  nvs_namespaces.push_back(name);
+  *out_handle = nvs_namespaces.size();
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+  if (handle > 0 && handle <= nvs_namespaces.size()) nvs_namespaces[handle - 1].clear();
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  return handle > 0 && handle <= nvs_namespaces.size() ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+  size_t value_length;
+  esp_err_t result = readKey(handle, key, out_value, *length, value_length);
+  if (result == ESP_OK) *length = value_length;
+  return result;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+  return writeKey(handle, key, value, length);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+  size_t value_length;
+  esp_err_t result = readKey(handle, key, out_value, *length > 0 ? *length - 1 : 0, value_length);
+  if (result != ESP_OK) return result;
+
+  if (out_value != nullptr) out_value[value_length] = '\0';
+  *length = value_length + 1;
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+  return writeKey(handle, key, value, strlen(value));
+}
@@ -0,0 +1,46 @@
+#ifndef NIMBLE_STAND_IN_NVS_H
+#define NIMBLE_STAND_IN_NVS_H
+
+/**
+ * @brief Host-side stand-in for the subset of the ESP-IDF NVS API used by the host tools
+ * @note Each key is kept in its own file, named namespace.key, in the directory given to NimBLEStandIn::setNvsDirectory(). Reads and writes are counted in NimBLEStandIn::counters().
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+typedef uint32_t nvs_handle_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_INVALID_HANDLE 0x1107
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+
+typedef enum {
+  NVS_READONLY,
+  NVS_READWRITE
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+
+/**
+ * @brief Read a blob; with out_value null, only its length is returned
+ */
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length);
+
+/**
+ * @brief Read a string; length includes the terminating null, with out_value null only the length is returned
+ */
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value);
+
+namespace NimBLEStandIn {
+  void setNvsDirectory(const char* path);
+}
+
+#endif // NIMBLE_STAND_IN_NVS_H
@@ -0,0 +1,481 @@
+/**
+ * @brief Checks behind the benchmark claims, run by ctest against the NimBLE stand-in
+ * @note Prints one line per failed check and exits non-zero if any check failed.
+ * @note Usage: btdevinf_test
+ */
+
+#include <BTDevInf.h>
+#include <BTDevInfRegulatory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+  int failures = 0;
+  std::atomic<size_t> heap_allocations(0);
+
+  void check(bool passed, const char* test, const char* what) {
+    if (passed) return;
+    printf("FAIL %s: %s\n", test, what);
+    failures++;
+  }
+
+  // Every published value is one octet repeated, and its length follows from that octet, so a torn read is detectable
+  size_t fillPattern(uint8_t* buffer, uint8_t octet, size_t max_length) {
+    size_t length = 1 + octet % max_length;
+    memset(buffer, octet, length);
+    return length;
+  }
+
+  bool isPattern(const std::vector<uint8_t>& value, size_t max_length) {
+    if (value.empty() || value.size() != 1 + value[0] % max_length) return false;
+    for (uint8_t octet : value) {
+      if (octet != value[0]) return false;
+    }
+    return true;
+  }
+
+  // Two writers race on a short value and one on a long value read with Read Blob requests; no read may see parts of two values
+  void testConcurrentUpdates() {
+    const char* TEST = "concurrent_updates";
+    const uint16_t SHORT_LENGTH = 64;
+    const uint16_t LONG_LENGTH = 200;
+
+    NimBLEServer server;
+    BTDevInf device_info(&server);
+    device_info.setFirmwareRevisionString("1.0.0");
+    check(device_info.enableConcurrentUpdates(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, SHORT_LENGTH), TEST, "enable on the short value");
+    check(device_info.enableConcurrentUpdates(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, LONG_LENGTH), TEST, "enable on the long value");
+    device_info.startService();
+    server.start();
+
+    std::vector<uint8_t> value;
+    NimBLEConnInfo conn_info(1, 185, true, true);
+    NimBLEStandIn::readLong(device_info.getFirmwareRevisionStringCharacteristic(), conn_info, value);
+    check(std::string(value.begin(), value.end()) == "1.0.0", TEST, "value set before enabling is kept");
+
+    // Both values are patterns before the race, so a reader that runs before any writer sees one too
+    uint8_t pattern[LONG_LENGTH];
+    device_info.setValue(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, pattern, fillPattern(pattern, 0, SHORT_LENGTH));
+    device_info.setValue(BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, pattern, fillPattern(pattern, 0, LONG_LENGTH));
+
+    std::atomic<bool> go(false);
+    std::atomic<bool> stop(false);
+    uint32_t reads = 0;
+    uint32_t torn_reads = 0;
+
+    auto writer = [&](BTDevInfCharacteristic characteristic, uint16_t max_length, uint8_t first) {
+      uint8_t buffer[LONG_LENGTH];
+      while (!go) {}
+      for (uint8_t octet = first; !stop; octet += 2) {
+        device_info.setValue(characteristic, buffer, fillPattern(buffer, octet, max_length));
+      }
+    };
+    std::thread writers[] = {
+      std::thread(writer, BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, SHORT_LENGTH, 0),
+      std::thread(writer, BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, SHORT_LENGTH, 1),
+      std::thread(writer, BTDevInfCharacteristic::SOFTWARE_REVISION_STRING, LONG_LENGTH, 0)
+    };
+    std::thread reader([&]() {
+      std::vector<uint8_t> read_value;
+      NimBLEConnInfo short_mtu(2, 23, true, true);
+      NimBLEConnInfo long_mtu(3, 185, true, true);
+      while (!go) {}
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+      while (std::chrono::steady_clock::now() < deadline) {
+        NimBLEStandIn::readLong(device_info.getFirmwareRevisionStringCharacteristic(), long_mtu, read_value);
+        if (!isPattern(read_value, SHORT_LENGTH)) torn_reads++;
+        NimBLEStandIn::readLong(device_info.getSoftwareRevisionStringCharacteristic(), short_mtu, read_value);
+        if (!isPattern(read_value, LONG_LENGTH)) torn_reads++;
+        reads += 2;
+      }
+      stop = true;
+    });
+
+    go = true;
+    reader.join();
+    for (std::thread& thread : writers) thread.join();
+
+    check(reads > 0, TEST, "reads ran");
+    check(torn_reads == 0, TEST, "torn_reads == 0");
+  }
+
+  // What a regulatory list entry should decode to
+  struct RegulatoryModelEntry {
+    enum Kind { CONTINUA_VERSION, REGULATION, OPAQUE } kind;
+    uint8_t auth_body;
+    uint8_t struc_type;
+    uint8_t major_version;
+    uint8_t minor_version;
+    std::vector<uint16_t> device_classes;
+    uint16_t regulation_bits;
+    std::vector<uint8_t> data;
+  };
+
+  std::vector<RegulatoryModelEntry> randomRegulatoryList(std::mt19937& random) {
+    std::vector<RegulatoryModelEntry> entries(random() % 9);
+    for (RegulatoryModelEntry& entry : entries) {
+      entry.kind = static_cast<RegulatoryModelEntry::Kind>(random() % 3);
+      entry.major_version = random();
+      entry.minor_version = random();
+      entry.regulation_bits = random();
+      if (entry.kind == RegulatoryModelEntry::CONTINUA_VERSION) {
+        entry.device_classes.resize(random() % 80);
+        for (uint16_t& device_class : entry.device_classes) device_class = random();
+      } else if (entry.kind == RegulatoryModelEntry::OPAQUE) {
+        // Any body but Continua, whose structures the decoder interprets
+        do {
+          entry.auth_body = random();
+        } while (entry.auth_body == BTDEVINF_REGULATORY_AUTH_BODY_CONTINUA);
+        entry.struc_type = random();
+        entry.data.resize(random() % 96);
+        for (uint8_t& octet : entry.data) octet = random();
+      }
+    }
+    return entries;
+  }
+
+  size_t encodedRegulatoryLength(const std::vector<RegulatoryModelEntry>& entries) {
+    size_t length = 4;
+    for (const RegulatoryModelEntry& entry : entries) {
+      if (entry.kind == RegulatoryModelEntry::CONTINUA_VERSION) length += 4 + 6 + 2 * entry.device_classes.size();
+      if (entry.kind == RegulatoryModelEntry::REGULATION) length += 4 + 2;
+      if (entry.kind == RegulatoryModelEntry::OPAQUE) length += 4 + entry.data.size();
+    }
+    return length;
+  }
+
+  void encodeRegulatoryList(const std::vector<RegulatoryModelEntry>& entries, BTDevInfRegulatoryEncoder& encoder) {
+    for (const RegulatoryModelEntry& entry : entries) {
+      if (entry.kind == RegulatoryModelEntry::CONTINUA_VERSION) {
+        encoder.addContinuaVersion(entry.major_version, entry.minor_version);
+        for (uint16_t device_class : entry.device_classes) encoder.addCertifiedDeviceClass(device_class);
+      } else if (entry.kind == RegulatoryModelEntry::REGULATION) {
+        encoder.addRegulationBitField(entry.regulation_bits);
+      } else {
+        encoder.addEntry(entry.auth_body, entry.struc_type, entry.data.data(), entry.data.size());
+      }
+    }
+  }
+
+  bool decodesTo(const uint8_t* data, size_t length, const std::vector<RegulatoryModelEntry>& entries) {
+    BTDevInfRegulatoryDecoder decoder(data, length);
+    if (!decoder.isValid() || decoder.getEntryCount() != entries.size()) return false;
+
+    for (uint16_t i = 0; i < entries.size(); i++) {
+      const RegulatoryModelEntry& expected = entries[i];
+      BTDevInfRegulatoryEntry entry;
+      if (!decoder.getEntry(i, entry)) return false;
+
+      if (expected.kind == RegulatoryModelEntry::CONTINUA_VERSION) {
+        BTDevInfContinuaVersion version;
+        if (!BTDevInfRegulatoryDecoder::decodeContinuaVersion(entry, version)) return false;
+        if (version.major_version != expected.major_version || version.minor_version != expected.minor_version) return false;
+        if (version.device_class_count != expected.device_classes.size()) return false;
+        for (uint16_t j = 0; j < version.device_class_count; j++) {
+          if (version.getCertifiedDeviceClass(j) != expected.device_classes[j]) return false;
+        }
+      } else if (expected.kind == RegulatoryModelEntry::REGULATION) {
+        uint16_t regulation_bits;
+        if (!BTDevInfRegulatoryDecoder::decodeRegulationBitField(entry, regulation_bits) || regulation_bits != expected.regulation_bits) return false;
+      } else {
+        if (entry.auth_body != expected.auth_body || entry.struc_type != expected.struc_type) return false;
+        if (entry.length != expected.data.size() || (entry.length > 0 && memcmp(entry.data, expected.data.data(), entry.length) != 0)) return false;
+      }
+    }
+    return true;
+  }
+
+  // Random lists must round-trip through the encoder and decoder, and damaged copies must never lead the decoder outside them
+  void testRegulatoryCodec() {
+    const char* TEST = "regulatory_codec";
+    std::mt19937 random(20601);
+    size_t round_trips = 0;
+    size_t mismatches = 0;
+    size_t overflows = 0;
+    size_t overflows_missed = 0;
+    size_t mutations_out_of_bounds = 0;
+
+    for (int i = 0; i < 20000; i++) {
+      std::vector<RegulatoryModelEntry> entries = randomRegulatoryList(random);
+      size_t expected_length = encodedRegulatoryLength(entries);
+
+      BTDevInfRegulatoryList<BLE_ATT_ATTR_MAX_LEN> list;
+      encodeRegulatoryList(entries, list);
+      if (expected_length > BLE_ATT_ATTR_MAX_LEN) {
+        overflows++;
+        if (!list.hasFailed() || list.getLength() != 0) overflows_missed++;
+        continue;
+      }
+      if (list.hasFailed() || list.getLength() != expected_length || !decodesTo(list.getData(), list.getLength(), entries)) {
+        mismatches++;
+        continue;
+      }
+      round_trips++;
+
+      std::vector<uint8_t> damaged(list.getData(), list.getData() + list.getLength());
+      if (random() % 2) {
+        damaged[random() % damaged.size()] ^= 1 << (random() % 8);
+      } else {
+        damaged.resize(random() % damaged.size());
+      }
+
+      BTDevInfRegulatoryDecoder decoder(damaged.data(), damaged.size());
+      for (uint16_t j = 0; j < decoder.getEntryCount(); j++) {
+        BTDevInfRegulatoryEntry entry;
+        BTDevInfContinuaVersion version;
+        if (!decoder.getEntry(j, entry) || entry.data + entry.length > damaged.data() + damaged.size()) {
+          mutations_out_of_bounds++;
+          break;
+        }
+        if (BTDevInfRegulatoryDecoder::decodeContinuaVersion(entry, version)
+          && version.device_classes + 2 * version.device_class_count > entry.data + entry.length) {
+          mutations_out_of_bounds++;
+          break;
+        }
+      }
+    }
+
+    check(round_trips > 0 && overflows > 0, TEST, "lists both within and over BLE_ATT_ATTR_MAX_LEN were generated");
+    check(mismatches == 0, TEST, "mismatches == 0");
+    check(overflows_missed == 0, TEST, "every list over BLE_ATT_ATTR_MAX_LEN fails to encode");
+    check(mutations_out_of_bounds == 0, TEST, "damaged lists are never read outside their data");
+
+    // Continua 1.0 certified for two device classes, regulated device
+    BTDevInfRegulatoryList<32> typical;
+    typical.addContinuaVersion(1, 0);
+    typical.addCertifiedDeviceClass(0x0004);
+    typical.addCertifiedDeviceClass(0x1007);
+    typical.addRegulationBitField(0);
+    check(typical.getLength() == 24 && typical.getEntryCount() == 2, TEST, "typical list is 24 octets in two entries");
+  }
+
+  // Updating existing characteristics, publishing concurrent updates, taking instrumentation snapshots and encoding and decoding regulatory lists must not allocate
+  void testHotPathAllocations() {
+    const char* TEST = "hot_path_allocations";
+    // Longer than any std::string small buffer
+    const char LONG_NAME[] = "Example Corporation Industrial Division";
+    const size_t LONG_NAME_LENGTH = sizeof(LONG_NAME) - 1;
+    const std::string long_name_string(LONG_NAME);
+    const uint8_t system_id[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0};
+
+    struct Update {
+      const char* name;
+      void (*call)(BTDevInf& device_info, const char* value, size_t length);
+    };
+    const Update updates[] = {
+      {"string literal update allocates", [](BTDevInf& d, const char* value, size_t) { d.setModelNumberString(value); }},
+      {"char buffer update allocates", [](BTDevInf& d, const char* value, size_t length) { d.setSerialNumberString(value, length); }},
+      {"string_view update allocates", [](BTDevInf& d, const char* value, size_t length) { d.setManufacturerNameString(std::string_view(value, length)); }},
+      {"byte update allocates", [](BTDevInf& d, const char* value, size_t length) { d.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(value), length); }},
+      {"PnP ID update allocates", [](BTDevInf& d, const char*, size_t length) { d.setPnPID(0x02, 0x303A, length, 0x0100); }}
+    };
+
+    NimBLEServer server;
+    BTDevInf device_info(&server);
+    device_info.enableInstrumentation();
+    device_info.setSystemID(system_id, sizeof(system_id));
+    device_info.setFirmwareRevisionString("1.0.0");
+    device_info.enableConcurrentUpdates(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING, 32);
+    for (const Update& update : updates) {
+      update.call(device_info, LONG_NAME, LONG_NAME_LENGTH);
+    }
+    device_info.startService();
+    server.start();
+
+    // Lengths vary, but never beyond the first value, which sized the value buffers
+    for (const Update& update : updates) {
+      size_t start = heap_allocations;
+      for (int i = 0; i < 1000; i++) {
+        update.call(device_info, LONG_NAME, LONG_NAME_LENGTH - i % 20);
+      }
+      check(heap_allocations == start, TEST, update.name);
+    }
+
+    size_t start = heap_allocations;
+    for (int i = 0; i < 1000; i++) {
+      device_info.setManufacturerNameString(long_name_string);
+      device_info.setSystemID(system_id, sizeof(system_id));
+    }
+    check(heap_allocations == start, TEST, "std::string and System ID updates allocate");
+
+    start = heap_allocations;
+    for (int i = 0; i < 1000; i++) {
+      device_info.setFirmwareRevisionString(std::string_view(LONG_NAME, 1 + i % 31));
+    }
+    check(heap_allocations == start, TEST, "concurrent update allocates");
+
+    BTDevInf::InstrumentationSnapshot snapshot;
+    start = heap_allocations;
+    for (int i = 0; i < 1000; i++) {
+      device_info.getInstrumentationSnapshot(snapshot);
+    }
+    check(heap_allocations == start, TEST, "instrumentation snapshot allocates");
+    const BTDevInf::CharacteristicStats& firmware = snapshot.characteristics[static_cast<size_t>(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING)];
+    check(firmware.published_bytes >= 3 * 32 && snapshot.published_bytes == firmware.published_bytes, TEST, "snapshot counts the concurrent update buffers");
+    check(firmware.value_bytes >= device_info.getCharacteristic(BTDevInfCharacteristic::FIRMWARE_REVISION_STRING)->getLength(), TEST, "snapshot counts value buffer capacity");
+
+    start = heap_allocations;
+    for (int i = 0; i < 1000; i++) {
+      BTDevInfRegulatoryList<64> list;
+      list.addContinuaVersion(1, 0);
+      list.addCertifiedDeviceClass(0x1007);
+      list.addRegulationBitField(0);
+      BTDevInfRegulatoryDecoder decoder(list.getData(), list.getLength());
+      BTDevInfRegulatoryEntry entry;
+      BTDevInfContinuaVersion version;
+      if (!decoder.getEntry(0, entry) || !BTDevInfRegulatoryDecoder::decodeContinuaVersion(entry, version)) check(false, TEST, "regulatory list decodes");
+    }
+    check(heap_allocations == start, TEST, "regulatory codec allocates");
+  }
+
+  // Handles, types and properties of every attribute of the service, as a client's GATT cache holds them
+  std::string handleLayout(NimBLEService* service) {
+    std::string layout;
+    auto put16 = [&layout](uint16_t value) {
+      layout.push_back(static_cast<char>(value & 0xFF));
+      layout.push_back(static_cast<char>(value >> 8));
+    };
+    auto putUUID = [&layout](const NimBLEUUID& uuid) {
+      layout.append(reinterpret_cast<const char*>(uuid.getValue()), uuid.bitSize() / 8);
+    };
+
+    put16(service->getHandle());
+    put16(service->getEndHandle());
+    for (const NimBLECharacteristic* characteristic : service->getCharacteristics()) {
+      put16(characteristic->getHandle());
+      put16(characteristic->getProperties());
+      putUUID(characteristic->getUUID());
+      for (const NimBLEDescriptor* descriptor : characteristic->getDescriptors()) {
+        put16(descriptor->getHandle());
+        putUUID(descriptor->getUUID());
+      }
+    }
+    return layout;
+  }
+
+  const uint8_t SYSTEM_ID[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0};
+  const uint8_t IEEE_DATA[] = {0x01, 0x02, 0x03, 0x04};
+  const char UDI[] = "(01)12345678901234";
+
+  void (*const SETTERS[])(BTDevInf& device_info) = {
+    [](BTDevInf& d) { d.setSystemID(SYSTEM_ID, sizeof(SYSTEM_ID)); },
+    [](BTDevInf& d) { d.setModelNumberString("EX-1000"); },
+    [](BTDevInf& d) { d.setSerialNumberString("SN123456789"); },
+    [](BTDevInf& d) { d.setFirmwareRevisionString("1.0.0"); },
+    [](BTDevInf& d) { d.setHardwareRevisionString("Rev A"); },
+    [](BTDevInf& d) { d.setSoftwareRevisionString("1.0.0"); },
+    [](BTDevInf& d) { d.setManufacturerNameString("Example Corp"); },
+    [](BTDevInf& d) { d.setIEEERegulatoryCertificationDataList(IEEE_DATA, sizeof(IEEE_DATA)); },
+    [](BTDevInf& d) { d.setPnPID(0x02, 0x303A, 0x1001, 0x0100); },
+    [](BTDevInf& d) { d.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(UDI), sizeof(UDI) - 1); }
+  };
+  constexpr size_t SETTER_COUNT = sizeof(SETTERS) / sizeof(SETTERS[0]);
+
+  struct LayoutResult {
+    std::string layout;
+    uint32_t hash;
+  };
+
+  LayoutResult buildLayout(const int* order, size_t count, BTDevInfDescriptorPolicy policy = BTDevInfDescriptorPolicy::FULL) {
+    NimBLEServer server;
+    BTDevInf device_info(&server);
+    device_info.setDescriptorPolicy(policy);
+    device_info.enableCanonicalLayout();
+    for (size_t i = 0; i < count; i++) {
+      SETTERS[order[i]](device_info);
+    }
+    device_info.startService();
+    server.start();
+    return {handleLayout(device_info.getService()), device_info.getLayoutHash()};
+  }
+
+  // With a canonical layout, neither the order of the setters nor which of them run may move a handle or change the hash
+  void testCanonicalLayout() {
+    const char* TEST = "canonical_layout";
+    int order[SETTER_COUNT];
+    for (size_t i = 0; i < SETTER_COUNT; i++) {
+      order[i] = static_cast<int>(i);
+    }
+    LayoutResult reference = buildLayout(order, SETTER_COUNT);
+    check(reference.hash != 0 && !reference.layout.empty(), TEST, "reference layout is built");
+
+    // Every order of the first eight setters, then the last two
+    size_t layout_mismatches = 0;
+    size_t hash_mismatches = 0;
+    do {
+      LayoutResult result = buildLayout(order, SETTER_COUNT);
+      if (result.layout != reference.layout) layout_mismatches++;
+      if (result.hash != reference.hash) hash_mismatches++;
+    } while (std::next_permutation(order, order + 8));
+    check(layout_mismatches == 0, TEST, "every setter order gives the same handles");
+    check(hash_mismatches == 0, TEST, "every setter order gives the same layout hash");
+
+    // Random orders of random subsets; the setters left out are reserved slots
+    std::mt19937 random(2803);
+    size_t subset_mismatches = 0;
+    for (int trial = 0; trial < 2000; trial++) {
+      std::shuffle(order, order + SETTER_COUNT, random);
+      LayoutResult result = buildLayout(order, random() % (SETTER_COUNT + 1));
+      if (result.layout != reference.layout || result.hash != reference.hash) subset_mismatches++;
+    }
+    check(subset_mismatches == 0, TEST, "every subset of setters gives the same handles and hash");
+
+    LayoutResult other_policy = buildLayout(order, SETTER_COUNT, BTDevInfDescriptorPolicy::PRESENTATION_FORMAT_ONLY);
+    check(other_policy.hash != reference.hash, TEST, "a descriptor policy change changes the layout hash");
+
+    NimBLEServer server;
+    BTDevInf device_info(&server);
+    device_info.enableCanonicalLayout(BTDEVINF_ALL_CHARACTERISTICS & ~btdevinfCharacteristicBit(BTDevInfCharacteristic::UDI_FOR_MEDICAL_DEVICES));
+    uint32_t empty_hash = device_info.getLayoutHash();
+    device_info.setSerialNumberString("SN987654321-REV2");
+    check(device_info.getLayoutHash() == empty_hash, TEST, "values do not change the layout hash");
+    check(!device_info.setUDIForMedicalDevices(reinterpret_cast<const uint8_t*>(UDI), sizeof(UDI) - 1), TEST, "a setter outside the layout fails");
+  }
+}
+
+void* operator new(size_t size) {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) throw std::bad_alloc();
+  return pointer;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  free(pointer);
+}
+
+int main() {
+  testConcurrentUpdates();
+  testRegulatoryCodec();
+  testHotPathAllocations();
+  testCanonicalLayout();
+
+  if (failures == 0) printf("All checks passed\n");
+  return failures == 0 ? 0 : 1;
+}